@@ -0,0 +1,77 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "loggerfactory.hpp"
+
+using namespace daq;
+
+//统计operator new的调用次数
+static std::atomic<size_t> g_allocCount{0};
+
+void* operator new(size_t size) {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+//只统计事件数量的Appender，排除格式化和IO的影响
+class NullAppender : public Appender {
+    public:
+        NullAppender() {
+            m_id += "::NullAppender";
+        }
+        virtual void append(LogEvent::sptr event) override {
+            ++m_count;
+        }
+        size_t m_count = 0;
+};
+
+int main() {
+    constexpr size_t N = 100000;
+    auto logger = LoggerFactory::instance()->initialize("alloc");
+    logger->addAppender(new NullAppender);
+    const std::string msg = "allocation test message, longer than the SSO buffer";
+
+    //预热，让池和字符串容量达到稳定状态
+    for (size_t i = 0; i < 16; ++i) {
+        logger->info(msg, LOCATIONINFO);
+    }
+
+    size_t before = g_allocCount.load();
+    for (size_t i = 0; i < N; ++i) {
+        logger->info(msg, LOCATIONINFO);
+    }
+    size_t after = g_allocCount.load();
+
+    std::cout << "Logger::info: " << double(after - before) / N << " allocations per call" << std::endl;
+
+    auto aslogger = AsLoggerFactory::instance()->initialize("as_alloc", LogLevel::TRACE, 4096);
+    aslogger->addAppender(new NullAppender);
+    for (size_t i = 0; i < 4096; ++i) {
+        aslogger->info(msg, LOCATIONINFO);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    before = g_allocCount.load();
+    for (size_t i = 0; i < N; ++i) {
+        aslogger->info(msg, LOCATIONINFO);
+        if (i % 1024 == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    after = g_allocCount.load();
+
+    std::cout << "AsLogger::info: " << double(after - before) / N << " allocations per call" << std::endl;
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "appender.hpp"
+#include "loggerfactory.hpp"
+
+using namespace daq;
+
+static const int kPort = 18090;
+static const int kDown = 2000;      //服务器不可用时写的日志条数，写入Spool后进程崩溃
+static const int kUp = 2000;        //重启并且服务器恢复后写的日志条数
+static const int kBatch = 10;       //每个请求的日志条数
+static const int kInflight = 4;     //同时发送的请求数
+
+/// 只接收HTTPAppender请求的HTTP服务器，按收到的顺序记录每条日志的序号
+class SeqServer {
+    public:
+        bool start() {
+            m_listen = socket(AF_INET, SOCK_STREAM, 0);
+            int on = 1;
+            setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(kPort);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (bind(m_listen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(m_listen, 16) != 0) {
+                std::cout << "SeqServer bind port " << kPort << " error: " << strerror(errno) << std::endl;
+                return false;
+            }
+            m_thread = std::thread(&SeqServer::run, this);
+            return true;
+        }
+        void stop() {
+            m_stop = true;
+            m_thread.join();
+            for (auto& conn : m_conns) {
+                close(conn.fd);
+            }
+            close(m_listen);
+        }
+        std::vector<long> received() {
+            std::lock_guard<std::mutex> lock_guard(m_mutex);
+            return m_seqs;
+        }
+
+    private:
+        struct Conn {
+            int fd;
+            std::string buffer;
+        };
+
+        void run() {
+            while (!m_stop) {
+                std::vector<pollfd> fds(1, pollfd{m_listen, POLLIN, 0});
+                for (auto& conn : m_conns) {
+                    fds.push_back(pollfd{conn.fd, POLLIN, 0});
+                }
+                if (poll(fds.data(), fds.size(), 100) <= 0) {
+                    continue;
+                }
+                if (fds[0].revents & POLLIN) {
+                    m_conns.push_back(Conn{accept(m_listen, nullptr, nullptr), ""});
+                }
+                for (size_t i = fds.size() - 1; i > 0; --i) {
+                    if (fds[i].revents && !readConn(m_conns[i - 1])) {
+                        close(m_conns[i - 1].fd);
+                        m_conns.erase(m_conns.begin() + i - 1);
+                    }
+                }
+            }
+        }
+
+        /// 读出完整的请求，记录请求体中的序号并回复200，连接关闭时返回false
+        bool readConn(Conn& conn) {
+            char buf[65536];
+            ssize_t n = recv(conn.fd, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                return false;
+            }
+            conn.buffer.append(buf, n);
+            for (;;) {
+                size_t end = conn.buffer.find("\r\n\r\n");
+                if (end == std::string::npos) {
+                    return true;
+                }
+                size_t pos = conn.buffer.find("Content-Length:");
+                size_t length = pos < end ? strtoul(conn.buffer.c_str() + pos + 15, nullptr, 10) : 0;
+                if (conn.buffer.size() < end + 4 + length) {
+                    return true;
+                }
+                std::string body = conn.buffer.substr(end + 4, length);
+                conn.buffer.erase(0, end + 4 + length);
+                {
+                    std::lock_guard<std::mutex> lock_guard(m_mutex);
+                    for (size_t p = body.find("\"seq\":"); p != std::string::npos; p = body.find("\"seq\":", p + 6)) {
+                        m_seqs.push_back(strtol(body.c_str() + p + 6, nullptr, 10));
+                    }
+                }
+                const char* reply = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+                send(conn.fd, reply, strlen(reply), MSG_NOSIGNAL);
+            }
+        }
+
+    private:
+        int m_listen = -1;
+        std::vector<Conn> m_conns;
+        std::atomic<bool> m_stop{false};
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::vector<long> m_seqs;
+};
+
+static HTTPAppender* addHttpAppender(Logger::sptr logger, const SpoolPolicy& spool) {
+    HttpBatchPolicy batch;
+    batch.maxEvents = kBatch;
+    HttpSendPolicy send;
+    send.maxInflight = kInflight;
+    send.retryMaxMs = 500;
+    auto appender = new HTTPAppender("127.0.0.1", kPort, batch, send, spool);
+    logger->setJsonFormatter("{\"seq\":%m}");
+    logger->addAppender(appender);
+    logger->setOutputLevel(LogLevel::INFO);
+    return appender;
+}
+
+static void removeDir(const std::string& dir) {
+    DIR* d = opendir(dir.c_str());
+    while (struct dirent* entry = d ? readdir(d) : nullptr) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+            unlink((dir + "/" + name).c_str());
+        }
+    }
+    if (d) {
+        closedir(d);
+    }
+    rmdir(dir.c_str());
+}
+
+//服务器不可用时子进程写日志，等日志都写入Spool后被SIGKILL杀死；
+//父进程启动服务器，重新打开同一个Spool继续写日志，检查服务器收到的日志一条不少、不重复，
+//Spool中的日志最先收到并且按顺序；Spool发送完后新的请求用kInflight个连接同时发送，
+//先后最多差kInflight个请求
+int main(void)
+{
+    SpoolPolicy spool;
+    spool.dir = "/tmp/httpspooltest." + std::to_string(getpid());
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        auto logger = LoggerFactory::instance()->initialize("down");
+        auto appender = addHttpAppender(logger, spool);
+        for (int i = 0; i < kDown; ++i) {
+            logger->info(std::to_string(i));
+        }
+        appender->flush();
+        appender->getSender()->waitIdle(10000);
+        raise(SIGKILL);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFSIGNALED(status)) {
+        std::cout << "child was not killed" << std::endl;
+        return 1;
+    }
+
+    SeqServer server;
+    if (!server.start()) {
+        return 1;
+    }
+    auto logger = LoggerFactory::instance()->initialize("up");
+    auto appender = addHttpAppender(logger, spool);
+    for (int i = kDown; i < kDown + kUp; ++i) {
+        logger->info(std::to_string(i));
+        if (i % 100 == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    appender->flush();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (server.received().size() < size_t(kDown + kUp) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    //多发的请求也要算上
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    server.stop();
+
+    std::vector<long> seqs = server.received();
+    std::vector<int> seen(kDown + kUp, 0);
+    int errors = 0;
+    int reordered = 0;
+    for (size_t i = 0; i < seqs.size(); ++i) {
+        long seq = seqs[i];
+        bool ok = seq >= 0 && seq < kDown + kUp && ++seen[seq] == 1;
+        if (ok && seq != long(i)) {
+            ++reordered;
+            ok = i >= size_t(kDown) && std::abs(seq - long(i)) < kInflight * kBatch;
+        }
+        if (!ok && ++errors <= 10) {
+            std::cout << "event " << i << " has seq " << seq << std::endl;
+        }
+    }
+    std::cout << "received " << seqs.size() << " events, expected " << kDown + kUp
+              << ", " << reordered << " reordered after the spool drained, sent "
+              << appender->getSender()->getSent() << " requests" << std::endl;
+    logger->clearAppender();
+    removeDir(spool.dir);
+    if (errors > 0 || seqs.size() != size_t(kDown + kUp)) {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -11,6 +11,7 @@ int main()
     for (int i = 0; i < 100; ++i) {
         DLOG_INFO(LOCATIONINFO, "%s %d", "jjj", 100);
         DLOG_INFO(LOCATIONINFO, "%s %d", "jjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjsssssssssssssssssssjjj", 100);
+        DLOGF_INFO("{} {}", "jjj", i);
     }
     return 0;
 }
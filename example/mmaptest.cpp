@@ -0,0 +1,88 @@
+#include <csignal>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "appender.hpp"
+#include "loggerfactory.hpp"
+
+using namespace daq;
+
+static const int kLines = 200000;   //崩溃前写的日志条数，1MB的分段会滚动几次
+
+static std::vector<std::string> listDir(const std::string& dir) {
+    std::vector<std::string> names;
+    DIR* d = opendir(dir.c_str());
+    while (struct dirent* entry = d ? readdir(d) : nullptr) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+            names.push_back(dir + "/" + name);
+        }
+    }
+    if (d) {
+        closedir(d);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+//子进程用MmapFileAppender写日志后被SIGKILL杀死，没有机会截断最后一个分段；
+//父进程按文件名顺序读出所有分段，去掉末尾的'\0'填充，检查日志一条不少、按顺序
+int main(void)
+{
+    std::string dir = "/tmp/mmaptest." + std::to_string(getpid());
+    mkdir(dir.c_str(), 0755);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        auto logger = LoggerFactory::instance()->initialize("mmap");
+        logger->setFormatter("%m%n");
+        logger->addAppender(new MmapFileAppender(dir, 1, "mmap", ".log"));
+        logger->setOutputLevel(LogLevel::INFO);
+        for (int i = 0; i < kLines; ++i) {
+            logger->info("line " + std::to_string(i));
+        }
+        raise(SIGKILL);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFSIGNALED(status)) {
+        std::cout << "child was not killed" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> files = listDir(dir);
+    int expected = 0;
+    int errors = 0;
+    for (const std::string& file : files) {
+        std::ifstream in(file, std::ios::binary);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        std::string content = ss.str();
+        content.erase(content.find_last_not_of('\0') + 1);
+        std::istringstream lines(content);
+        std::string line;
+        while (std::getline(lines, line)) {
+            if (line != "line " + std::to_string(expected) && ++errors <= 10) {
+                std::cout << file << ": expected line " << expected << ", got \"" << line << "\"" << std::endl;
+            }
+            ++expected;
+        }
+        unlink(file.c_str());
+    }
+    rmdir(dir.c_str());
+
+    std::cout << "read " << expected << " lines from " << files.size() << " segments, expected " << kLines << std::endl;
+    if (errors > 0 || expected != kLines) {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
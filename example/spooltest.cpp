@@ -0,0 +1,107 @@
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <iostream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "spool.hpp"
+
+using namespace daq;
+
+static const int kRecords = 1000;   //崩溃前写入的记录数
+static const int kConsumed = 100;   //崩溃前已经取走的记录数
+static const int kAfter = 10;       //重启后写入的记录数
+
+/// 目录中最新的段文件
+static std::string lastSegment(const std::string& dir) {
+    std::string last;
+    DIR* d = opendir(dir.c_str());
+    while (struct dirent* entry = d ? readdir(d) : nullptr) {
+        std::string name = entry->d_name;
+        if (name.size() > 6 && name.compare(name.size() - 6, 6, ".spool") == 0 && name > last) {
+            last = name;
+        }
+    }
+    if (d) {
+        closedir(d);
+    }
+    return last.empty() ? last : dir + "/" + last;
+}
+
+static void removeDir(const std::string& dir) {
+    DIR* d = opendir(dir.c_str());
+    while (struct dirent* entry = d ? readdir(d) : nullptr) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+            unlink((dir + "/" + name).c_str());
+        }
+    }
+    if (d) {
+        closedir(d);
+    }
+    rmdir(dir.c_str());
+}
+
+//子进程写入记录、取走一部分，在段末尾留下写了一半的记录后被SIGKILL杀死；
+//父进程重新打开目录，检查剩下的记录一条不少、按顺序取出，并且重启后还能继续写入
+int main(void)
+{
+    SpoolPolicy policy;
+    policy.dir = "/tmp/spooltest." + std::to_string(getpid());
+    policy.segmentBytes = 4096;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        auto spool = Spool::open(policy);
+        for (int i = 0; i < kRecords; ++i) {
+            std::string record = "record " + std::to_string(i);
+            spool->push(record.data(), record.size());
+        }
+        std::string data;
+        uint32_t flags = 0;
+        for (int i = 0; i < kConsumed && spool->front(data, flags); ++i) {
+            spool->pop();
+        }
+        int fd = ::open(lastSegment(policy.dir).c_str(), O_WRONLY | O_APPEND);
+        ::write(fd, "\x20\x00\x00\x00torn", 8);
+        raise(SIGKILL);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFSIGNALED(status)) {
+        std::cout << "child was not killed" << std::endl;
+        return 1;
+    }
+
+    auto spool = Spool::open(policy);
+    for (int i = kRecords; i < kRecords + kAfter; ++i) {
+        std::string record = "record " + std::to_string(i);
+        spool->push(record.data(), record.size());
+    }
+    int expected = kConsumed;
+    int errors = 0;
+    std::string data;
+    uint32_t flags = 0;
+    while (spool->front(data, flags)) {
+        if (data != "record " + std::to_string(expected)) {
+            if (++errors <= 10) {
+                std::cout << "expected record " << expected << ", got \"" << data << "\"" << std::endl;
+            }
+        }
+        ++expected;
+        spool->pop();
+    }
+    spool.reset();
+    removeDir(policy.dir);
+
+    int count = expected - kConsumed;
+    std::cout << "recovered " << count << " records, expected " << kRecords + kAfter - kConsumed << std::endl;
+    if (errors > 0 || count != kRecords + kAfter - kConsumed) {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
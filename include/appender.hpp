@@ -6,12 +6,21 @@
 #include <fstream>
 #include <functional>
 #include <mutex>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
 
 #include <czmq.h>
 #include <curl/curl.h>
 
 #include "loglevel.hpp"
 #include "formatter.hpp"
+#include "filewriter.hpp"
+#include "logcompressor.hpp"
+#include "segmentlist.hpp"
+#include "httpsender.hpp"
+#include "spool.hpp"
+#include "zmqbatch.hpp"
 
 namespace daq {
 
@@ -56,19 +65,49 @@ class Appender {
         std::string m_id = "Appender"; ///避免相同LogAppender加入到Logger，使得重复输出
         Formatter::sptr m_formatter;
         std::mutex m_appendMutex;
+        std::string m_formatBuffer;    ///格式化缓冲区，在m_appendMutex保护下复用
+};
+
+/// \brief 控制台输出的目标
+enum class ConsoleStream {
+    STDOUT = 1,
+    STDERR = 2,
 };
 
 /// \brief StdoutAppender输出到控制台
+///
+/// 日志写入进程内共享的ConsoleWriter缓冲区，多个线程的日志合并写出；
+/// 终端上按行写出，管道和文件上按刷新策略写出
 class StdoutAppender : public Appender {
     public:
         /// \brief 构造函数
-        StdoutAppender();
+        ///
+        /// \param stream 输出目标，默认和原来的std::clog一样是标准错误
+        explicit StdoutAppender(ConsoleStream stream = ConsoleStream::STDERR);
         virtual void append(LogEvent::sptr event) override;
         /// \brief 析构函数
         ~StdoutAppender() = default;
+        /// \brief 设置刷新策略，作用于同一输出目标的所有StdoutAppender
+        ///
+        /// \param policy 刷新策略
+        void setFlushPolicy(const FlushPolicy& policy) {
+            m_writer->setPolicy(policy);
+        }
+        /// \brief 把共享缓冲区中的日志写出
+        void flush() {
+            m_writer->flush();
+        }
+
+    private:
+        ConsoleWriter* m_writer;
 };
 
 /// \FileRollAppender滚动输出到文件
+///
+/// 文件大小记录在内存中，日志经过FileWriter的缓冲区写入，按FlushPolicy刷新。
+/// 文件名为"前缀 + 年月日时分秒-序号 + 后缀"，序号保证同一秒内滚动的文件不重名。
+/// 超过大小、到达RollPeriod的整点或调用rollOver(如每个run开始时)时滚动，
+/// 旧文件按RetentionPolicy在后台删除
 class RollFileAppender : public Appender {
     public:
         /// \brief 默认构造函数
@@ -79,8 +118,10 @@ class RollFileAppender : public Appender {
         /// \param size 文件大小
         /// \param prefix 文件前缀
         /// \param subfix 文件后缀
+        /// \param policy 刷新策略
         RollFileAppender(const std::string & path, u_int32_t size = 8,
-                         const std::string & prefix = "", const std::string & subfix = "");
+                         const std::string & prefix = "", const std::string & subfix = "",
+                         const FlushPolicy& policy = FlushPolicy());
         /// \brief 析构函数
         ~RollFileAppender();
 
@@ -114,24 +155,67 @@ class RollFileAppender : public Appender {
         void setSubfix(const std::string& subfix) {
             m_subfix = subfix;
         }
+        /// \brief 设置刷新策略
+        ///
+        /// \param policy 刷新策略
+        void setFlushPolicy(const FlushPolicy& policy);
+        /// \brief 把缓冲区中的日志写入文件
+        void flush();
+        /// \brief 设置滚动后文件的压缩方式，压缩在LogCompressor的后台线程中进行；
+        ///        目录中以前运行留下的没有压缩的文件也一起提交
+        ///
+        /// \param compression 压缩方式
+        void setCompression(Compression compression);
+        /// \brief 设置按时间滚动的周期
+        ///
+        /// \param period 周期
+        void setRollPeriod(RollPeriod period);
+        /// \brief 设置旧文件的保留策略
+        ///
+        /// \param policy 保留策略
+        void setRetention(const RetentionPolicy& policy);
+        /// \brief 立即滚动到新文件，例如在每个run开始时调用
+        void rollOver();
+        /// \brief 当前正在写的文件名
+        std::string getCurrentFileName() {
+            std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+            return m_currentFileName;
+        }
 
     private:
+        /// \brief 关闭当前文件并提交压缩，打开新文件
+        void roll();
+        /// \brief 把已经关闭的文件加入列表，需要时提交压缩
+        void finishFile(const std::string& path, uint64_t size);
+        /// \brief 根据当前时间计算下一次按时间滚动的时刻
+        void updateNextRollTime();
+
+    private:
+        Compression m_compression = Compression::NONE;
+        RollPeriod m_period = RollPeriod::NONE;
+        uint64_t m_nextRollTime = UINT64_MAX;   ///下一次按时间滚动的时刻，纳秒
+        std::string m_lastStamp;                ///上一个文件名中的时间戳
+        uint32_t m_sequence = 0;                ///同一时间戳内的序号
+        SegmentList::sptr m_segments = std::make_shared<SegmentList>();
         std::string m_path;
-        size_t m_maxFileSize;       ///文件最大大小MB
+        size_t m_maxFileSize = 8;   ///文件最大大小MB
         std::string m_prefix;
         std::string m_subfix;
         std::string m_currentFileName;
-        std::ofstream m_fileStream;
+        FileWriter m_writer;
 };
 
 /// \FileAppender输出到指定文件
+///
+/// 日志经过FileWriter的缓冲区写入，缓冲区满、定时器到期或者遇到高等级日志时刷新
 class SingleFileAppender : public Appender {
     public:
         SingleFileAppender();
         /// \brief 构造函数
         ///
         /// \param 日志文件名
-        SingleFileAppender(const std::string& name);
+        /// \param policy 刷新策略
+        SingleFileAppender(const std::string& name, const FlushPolicy& policy = FlushPolicy());
         ~SingleFileAppender();
 
         /// \brief 日志输出函数
@@ -142,10 +226,84 @@ class SingleFileAppender : public Appender {
             m_fileName = filename;
         }
         bool reopen();
+        /// \brief 设置刷新策略
+        ///
+        /// \param policy 刷新策略
+        void setFlushPolicy(const FlushPolicy& policy);
+        /// \brief 把缓冲区中的日志写入文件
+        void flush();
 
     private:
         std::string m_fileName;
-        std::ofstream m_fileStream;
+        FileWriter m_writer;
+};
+
+/// \brief 内存映射的分段文件输出
+///
+/// 每个分段文件创建时用fallocate预分配并mmap到内存，写一条日志只是一次memcpy到页缓存，
+/// 没有系统调用。分段写满时截断到实际长度并滚动到新文件，文件名和RollFileAppender相同。
+/// 脏页属于内核，进程崩溃时已经写入的日志不会丢失，但最后一个分段保持预分配的大小，
+/// 末尾是'\0'填充。定时在LogFlusher线程中发起异步回写(sync_file_range)，不等待完成
+class MmapFileAppender : public Appender {
+    public:
+        /// \brief 构造函数
+        ///
+        /// \param path 日志存放目录
+        /// \param size 分段文件大小MB
+        /// \param prefix 文件前缀
+        /// \param subfix 文件后缀
+        /// \param syncIntervalMs 发起异步回写的间隔(毫秒)，0表示完全交给内核
+        MmapFileAppender(const std::string& path, u_int32_t size = 64,
+                         const std::string& prefix = "", const std::string& subfix = "",
+                         uint32_t syncIntervalMs = 1000);
+        ~MmapFileAppender();
+
+        /// \brief 日志输出函数
+        ///
+        /// \param 日志事件
+        virtual void append(LogEvent::sptr event) override;
+        /// \brief 对新写入的部分发起异步回写
+        void sync();
+        /// \brief 立即滚动到新的分段
+        void rollOver();
+        /// \brief 设置旧分段的保留策略
+        ///
+        /// \param policy 保留策略
+        void setRetention(const RetentionPolicy& policy);
+        /// \brief 当前正在写的文件名
+        std::string getCurrentFileName() {
+            std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+            return m_currentFileName;
+        }
+
+    private:
+        /// \brief 创建并映射新的分段
+        bool openSegment();
+        /// \brief 没有分段时调用openSegment，失败后按退避时间重试
+        bool reopenSegment();
+        /// \brief 解除映射，截断到实际长度并关闭当前分段
+        void closeSegment();
+        /// \brief 没有分段时丢弃一条日志，最多每秒打印一次
+        void drop();
+
+    private:
+        SegmentList::sptr m_segments = std::make_shared<SegmentList>();
+        std::string m_path;
+        std::string m_prefix;
+        std::string m_subfix;
+        std::string m_currentFileName;
+        std::string m_lastStamp;                ///上一个文件名中的时间戳
+        uint32_t m_sequence = 0;                ///同一时间戳内的序号
+        size_t m_segmentSize;                   ///分段大小，按页对齐
+        int m_fd = -1;
+        char* m_base = nullptr;                 ///分段的映射地址
+        size_t m_used = 0;                      ///分段中已经写入的字节数
+        size_t m_synced = 0;                    ///已经发起回写的字节数
+        uint32_t m_openBackoffMs = 0;           ///openSegment连续失败后的重试间隔
+        std::chrono::steady_clock::time_point m_nextOpen;   ///下一次重试openSegment的时间
+        uint64_t m_dropped = 0;
+        uint64_t m_reported = 0;                ///已经打印过的丢弃数
+        std::chrono::steady_clock::time_point m_lastDropReport;
 };
 
 //ZMQ发送log,"inetAddr:port"
@@ -158,15 +316,26 @@ class ZMQAppender : public Appender {
         ///
         /// \param host 主机地址
         /// \param port 端口号
-        ZMQAppender(const std::string& host, const std::string& port);
-        ZMQAppender(const std::string& host, size_t port);
-        ZMQAppender(const std::string& endpoint);
+        /// \param policy 批量发送和套接字选项
+        /// \param spool 本地缓存，设置后发送不再阻塞，接收端不可用时日志写入缓存，
+        ///        由后台线程按顺序批量发送，追上之前新的日志也先写入缓存；目录为空时不缓存
+        ZMQAppender(const std::string& host, const std::string& port,
+                    const ZmqSendPolicy& policy = ZmqSendPolicy(),
+                    const SpoolPolicy& spool = SpoolPolicy());
+        ZMQAppender(const std::string& host, size_t port,
+                    const ZmqSendPolicy& policy = ZmqSendPolicy(),
+                    const SpoolPolicy& spool = SpoolPolicy());
+        ZMQAppender(const std::string& endpoint,
+                    const ZmqSendPolicy& policy = ZmqSendPolicy(),
+                    const SpoolPolicy& spool = SpoolPolicy());
         ~ZMQAppender();
 
-        /// \brief 日志输出函数
+        /// \brief 日志输出函数，日志加入当前批次，达到条数或字节数时作为一个多帧消息发送
         ///
         /// \param 日志事件
         virtual void append(LogEvent::sptr event) override;
+        /// \brief 发送当前批次，失败时写入缓存
+        void flush();
         void setEndpoint(const std::string& endpoint) {
             m_endpoint = endpoint;
         }
@@ -190,11 +359,37 @@ class ZMQAppender : public Appender {
         }
 
     private:
-        zsock_t *m_push;
+        void init(const ZmqSendPolicy& policy, const SpoolPolicy& spool);
+        /// \brief 创建m_push，设置选项后连接接收端
+        void connect();
+        /// \brief 发送一个批次，中途失败时重建套接字，调用时持有m_appendMutex
+        bool sendBatch(ZmqBatch& batch);
+        /// \brief 发送当前批次，失败时写入缓存或者丢弃，调用时持有m_appendMutex
+        void send();
+        /// \brief 后台线程，把缓存中的日志按批次发送
+        void drain();
+        /// \brief 从缓存中读出一批日志发送，成功时取走，返回发送的条数
+        ///
+        /// \param locked 调用者是否已经持有m_appendMutex
+        size_t drainBatch(ZmqBatch& batch, std::vector<std::string>& records, bool locked);
+
+    private:
+        zsock_t *m_push = nullptr;
         std::string m_host;
         std::string m_port;
         std::string m_endpoint;
         std::ofstream m_fileStream;
+        ZmqSendPolicy m_policy;
+        ZmqBatch m_batch;
+        std::unique_ptr<Spool> m_spool;
+        bool m_spooling = false;                                ///新的日志写入缓存，由m_appendMutex保护
+        std::thread m_drainThread;
+        std::mutex m_drainMutex;
+        std::condition_variable m_drainCond;
+        bool m_stop = false;                                    ///由m_drainMutex保护
+        uint64_t m_dropped = 0;
+        uint64_t m_reported = 0;                                ///已经打印过的丢弃数
+        std::chrono::steady_clock::time_point m_lastDropReport;
 };
 
 //HTTP发送JSON
@@ -205,32 +400,54 @@ class HTTPAppender : public Appender {
         ///
         /// \param host 主机地址
         /// \param port 端口号
-        HTTPAppender(const std::string& host, const std::string& port);
+        /// \param policy 批量发送策略
+        /// \param sendPolicy 发送、重试和积压的策略
+        /// \param spool 服务器不可用时的本地缓存，目录为空时不缓存
+        HTTPAppender(const std::string& host, const std::string& port,
+                     const HttpBatchPolicy& policy = HttpBatchPolicy(),
+                     const HttpSendPolicy& sendPolicy = HttpSendPolicy(),
+                     const SpoolPolicy& spool = SpoolPolicy());
         /// \brief HTTPAppender HTTP发送JSON格式的LogEvent
         ///
         /// \param host 主机地址
         /// \param port 端口号
-        HTTPAppender(const std::string& host, size_t port);
+        /// \param policy 批量发送策略
+        /// \param sendPolicy 发送、重试和积压的策略
+        /// \param spool 服务器不可用时的本地缓存，目录为空时不缓存
+        HTTPAppender(const std::string& host, size_t port,
+                     const HttpBatchPolicy& policy = HttpBatchPolicy(),
+                     const HttpSendPolicy& sendPolicy = HttpSendPolicy(),
+                     const SpoolPolicy& spool = SpoolPolicy());
         ~HTTPAppender();
 
-        /// \brief 日志输出函数
+        /// \brief 日志输出函数，日志先加入当前批次，达到条数或字节数时交给HttpSender发送，不会阻塞
         ///
         /// \param 日志事件
         virtual void append(LogEvent::sptr event) override;
+        /// \brief 设置批量发送策略
+        ///
+        /// \param policy 批量发送策略
+        void setBatchPolicy(const HttpBatchPolicy& policy);
+        /// \brief 立即把当前批次交给HttpSender，进程退出时等待发送完成
+        void flush();
+        /// \brief 得到发送器，可以查询发送和丢弃的请求数
+        HttpSender* getSender() {
+            return m_sender.get();
+        }
 
     private:
-        int init();
+        void init(const HttpSendPolicy& sendPolicy, const SpoolPolicy& spool);
+        /// \brief 把当前批次交给HttpSender，调用时持有m_appendMutex
+        void send();
 
     private:
         std::string m_host;
         long m_port;
-
-        CURL *pCurl = NULL;
         std::string m_url;
 
-        struct curl_slist *headerlist = NULL;
-        struct curl_httppost *post = NULL;
-        struct curl_httppost *last = NULL;
+        HttpBatchPolicy m_policy;
+        HttpBatch m_batch;
+        std::unique_ptr<HttpSender> m_sender;
 };
 
 } //DAQ
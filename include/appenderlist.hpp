@@ -0,0 +1,114 @@
+#ifndef __APPENDERLIST_HPP_
+#define __APPENDERLIST_HPP_
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <list>
+
+#include <boost/noncopyable.hpp>
+
+namespace daq {
+
+class Appender;
+
+/**
+ * @brief Logger使用的appender集合，读无锁的写时复制数组
+ *
+ * 集合保存在一个不可变的连续数组快照中，修改时复制出新快照并原子地替换。
+ * 读者(输出日志的线程)进入读临界区时只在自己的计数槽上加减一次计数，
+ * 不加锁也不遍历map；写者替换快照后等待一个宽限期(所有可能看到旧快照的读者退出)，
+ * 再释放旧快照和被删除的appender。
+ *
+ * 读临界区内(即Appender::append中)不能修改同一个AppenderList，否则写者会等待自己
+ */
+class AppenderList : public boost::noncopyable {
+    public:
+        /// 不可变的快照
+        struct Snapshot {
+            std::vector<Appender*> appenders;   //按加入顺序
+            std::vector<std::string> ids;       //与appenders一一对应
+        };
+
+        AppenderList();
+        ~AppenderList();
+
+        /**
+         * @brief read 在读临界区内访问当前的appender数组
+         *
+         * @param f 参数为const std::vector<Appender*>&的函数
+         */
+        template<typename F>
+        void read(F&& f) const {
+            ReadGuard guard(*this);
+            f(m_snapshot.load(std::memory_order_seq_cst)->appenders);
+        }
+
+        /**
+         * @brief add 加入appender，id已经存在时不加入
+         *
+         * @param id appender的id
+         * @param appender appender
+         *
+         * @return 是否加入
+         */
+        bool add(const std::string& id, Appender* appender);
+
+        /**
+         * @brief remove 删除appender，返回时已经没有读者在使用它
+         *
+         * @param id appender的id
+         *
+         * @return 被删除的appender，由调用者释放；不存在时为nullptr
+         */
+        Appender* remove(const std::string& id);
+
+        /**
+         * @brief clear 删除所有appender，返回时已经没有读者在使用它们
+         *
+         * @return 被删除的appender，由调用者释放
+         */
+        std::vector<Appender*> clear();
+
+        /// @brief getIds 所有appender的id
+        std::list<std::string> getIds() const;
+
+    private:
+        static constexpr size_t SLOTS = 16;   ///读者计数槽的个数，线程按顺序分配到各个槽
+
+        /// 一个计数槽，两个计数对应两个阶段，独占一个cache line
+        struct ReaderSlot {
+            std::atomic<uint32_t> count[2];
+            char pad[64 - 2 * sizeof(std::atomic<uint32_t>)];
+        };
+
+        /// 读临界区
+        class ReadGuard {
+            public:
+                explicit ReadGuard(const AppenderList& list);
+                ~ReadGuard();
+            private:
+                std::atomic<uint32_t>* m_count;
+        };
+
+        /// @brief publish 替换快照并等待宽限期，然后释放旧快照，调用时持有m_writeMutex
+        void publish(Snapshot* snapshot);
+        /// @brief synchronize 等待进入临界区时可能看到旧快照的读者全部退出
+        void synchronize();
+        /// @brief waitReaders 等待某个阶段的读者计数归零
+        void waitReaders(unsigned phase);
+        /// @brief threadSlot 当前线程使用的计数槽下标
+        static size_t threadSlot();
+
+    private:
+        std::atomic<Snapshot*> m_snapshot;
+        std::atomic<unsigned> m_phase{0};
+        mutable ReaderSlot m_readers[SLOTS];
+        std::mutex m_writeMutex;
+};
+
+}
+
+#endif /* __APPENDERLIST_HPP_ */
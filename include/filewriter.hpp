@@ -0,0 +1,265 @@
+#ifndef __FILEWRITER_HPP_
+#define __FILEWRITER_HPP_
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+#include <boost/noncopyable.hpp>
+
+#include "loglevel.hpp"
+#include "ioengine.hpp"
+
+namespace daq {
+
+/// @brief 文件输出的刷新策略，满足任一条件时把缓冲区写入文件；也包括写入方式
+struct FlushPolicy {
+    size_t bufferSize = 256 * 1024;        ///缓冲区大小，写满时刷新
+    uint32_t intervalMs = 50;              ///定时刷新的间隔(毫秒)，0表示不定时刷新
+    LogLevel level = LogLevel::ERROR;      ///不低于该等级的日志写入后立即刷新
+    uint32_t asyncDepth = 0;               ///同时在写的缓冲区个数，0表示在调用线程中同步write(2)
+    bool directIo = false;                 ///用O_DIRECT绕过页缓存，文件系统不支持时忽略
+    bool preallocate = false;              ///滚动文件打开时按最大大小预分配磁盘空间
+};
+
+/**
+ * @brief 带用户态缓冲区的文件写入器
+ *
+ * 日志先memcpy到按页对齐的缓冲区中，缓冲区满时才调用write(2)，
+ * 放不下的大块数据和缓冲区一起用writev(2)写出。已写入的字节数记录在内存中，
+ * 不需要stat文件。不是线程安全的，由调用者(Appender)加锁
+ *
+ * asyncDepth不为0时使用asyncDepth+1个缓冲区，写满(或者刷新)的缓冲区交给IoEngine异步写到
+ * 固定的偏移，调用者换一个空闲的缓冲区继续写，只有所有缓冲区都在写时才等待。
+ * 刷新只是提交，close和进程退出时才等待写完成
+ *
+ * directIo时数据不进入页缓存，不挤占采集数据的缓存。每次写出按块补齐，
+ * 最后一个不完整的块留在缓冲区中，下次刷新时重写；close时把文件截断到实际长度
+ */
+class FileWriter : public boost::noncopyable {
+    public:
+        explicit FileWriter(const FlushPolicy& policy = FlushPolicy());
+        /// @brief 析构时刷新缓冲区并关闭文件
+        ~FileWriter();
+
+        /**
+         * @brief open 打开文件，已经打开的文件先关闭
+         *
+         * @param path 文件名
+         * @param truncate true清空文件，false追加到文件末尾
+         * @param preallocate 预分配的字节数，不改变文件长度，0表示不预分配
+         *
+         * @return 是否成功
+         */
+        bool open(const std::string& path, bool truncate = true, uint64_t preallocate = 0);
+        /**
+         * @brief attach 写入已经打开的文件(如标准输出)，close时不关闭它
+         *
+         * @param fd 文件描述符
+         * @param name 出错时显示的名字
+         */
+        void attach(int fd, const std::string& name);
+        /// @brief close 刷新缓冲区并关闭文件
+        void close();
+        bool isOpen() const {
+            return m_fd >= 0;
+        }
+
+        /**
+         * @brief write 写入数据，缓冲区满时刷新
+         *
+         * @param data 数据
+         * @param len 长度
+         */
+        void write(const char* data, size_t len);
+        /**
+         * @brief write 写入一条日志，等级不低于刷新策略中的等级时立即刷新
+         *
+         * @param data 数据
+         * @param len 长度
+         * @param level 日志等级
+         */
+        void write(const char* data, size_t len, LogLevel level) {
+            write(data, len);
+            if (level >= m_policy.level) {
+                flush();
+            }
+        }
+        /// @brief flush 把缓冲区写入文件，异步模式下只提交不等待
+        void flush();
+        /// @brief drain 提交缓冲区并等待所有异步写完成
+        void drain();
+
+        /// @brief size 文件当前的大小，包括还在缓冲区中的数据
+        uint64_t size() const {
+            return m_fileSize + m_used;
+        }
+        /// @brief buffered 缓冲区中还没有写入文件的字节数
+        size_t buffered() const {
+            return m_used;
+        }
+        const std::string& getPath() const {
+            return m_path;
+        }
+
+        /// @brief setPolicy 修改刷新策略，缓冲区大小变化时先刷新再重新分配
+        void setPolicy(const FlushPolicy& policy);
+        const FlushPolicy& getPolicy() const {
+            return m_policy;
+        }
+
+    private:
+        /// @brief writeAll 写出iov中的全部数据，处理EINTR和部分写入
+        void writeAll(struct iovec* iov, int count);
+        /// @brief allocBuffer 按页对齐分配缓冲区，异步模式下同时创建IoEngine
+        void allocBuffer();
+        void freeBuffer();
+        /// @brief submit 异步模式下提交当前缓冲区，换到空闲的缓冲区
+        void submit();
+        /// @brief reap 处理完成的异步写，wait为true时至少等待一个
+        void reap(bool wait);
+        /// @brief waitInflight 等待所有异步写完成
+        void waitInflight();
+        /// @brief writeDirect O_DIRECT模式下按块对齐写出缓冲区
+        void writeDirect();
+        /// @brief truncateTail O_DIRECT模式下把文件截断到实际写入的长度
+        void truncateTail();
+
+    private:
+        static constexpr size_t ALIGNMENT = 4096;
+
+        FlushPolicy m_policy;
+        std::string m_path;
+        int m_fd = -1;
+        char* m_buffer = nullptr;       //缓冲区，按ALIGNMENT对齐
+        size_t m_used = 0;              //缓冲区中的字节数
+        uint64_t m_fileSize = 0;        //已经写入文件的字节数，异步模式下包括正在写的
+        size_t m_flushed = 0;           //O_DIRECT模式下缓冲区中已经写到文件的字节数
+        bool m_direct = false;          //文件是否以O_DIRECT打开
+        bool m_owned = true;            //close时是否关闭m_fd，attach的文件为false
+
+        struct Pending {
+            uint64_t offset;
+            size_t len;
+        };
+        std::unique_ptr<IoEngine> m_engine;     //异步模式的写引擎
+        std::vector<char*> m_buffers;           //异步模式的所有缓冲区，m_buffer是其中之一
+        std::vector<Pending> m_pending;         //每个缓冲区正在写的位置
+        std::vector<unsigned> m_free;           //空闲缓冲区的下标
+        unsigned m_current = 0;                 //m_buffer的下标
+        size_t m_inflight = 0;                  //正在写的缓冲区个数
+};
+
+/**
+ * @brief 标准输出和标准错误的进程内共享缓冲区
+ *
+ * 所有StdoutAppender共享，多个线程、多个logger的日志合并成一次write(2)。
+ * 输出到终端时每条日志立即写出(行缓冲)；输出到管道或文件时按刷新策略写出(块缓冲)。
+ * 和程序自己用std::cout输出的内容之间不保证顺序
+ */
+class ConsoleWriter : public boost::noncopyable {
+    public:
+        /**
+         * @brief instance 得到标准输出或者标准错误的共享缓冲区
+         *
+         * @param fd STDOUT_FILENO或者STDERR_FILENO
+         */
+        static ConsoleWriter* instance(int fd);
+
+        /**
+         * @brief write 写入一条日志，终端上或者等级不低于刷新策略中的等级时立即写出
+         *
+         * @param data 数据
+         * @param len 长度
+         * @param level 日志等级
+         */
+        void write(const char* data, size_t len, LogLevel level);
+        void flush();
+        /// @brief setPolicy 修改刷新策略，只使用缓冲区大小、间隔和等级
+        void setPolicy(const FlushPolicy& policy);
+        bool isTty() const {
+            return m_tty;
+        }
+
+    private:
+        explicit ConsoleWriter(int fd);
+        ~ConsoleWriter() = default;
+
+    private:
+        std::mutex m_mutex;
+        FileWriter m_writer;
+        bool m_tty;             //输出到终端时按行写出
+};
+
+/**
+ * @brief 进程内唯一的定时刷新线程
+ *
+ * Appender注册一个刷新函数和间隔，线程在最近的到期时间醒来调用到期的刷新函数，
+ * 没有注册时一直挂起。进程正常退出时(atexit)调用所有刷新函数，避免丢失缓冲的日志
+ */
+class LogFlusher : public boost::noncopyable {
+    public:
+        static LogFlusher* instance();
+
+        /**
+         * @brief add 注册刷新函数，同一个key重复注册时替换
+         *
+         * @param key 注册者，一般是Appender的this
+         * @param flush 刷新函数，在刷新线程中调用，需要自己加锁
+         * @param intervalMs 间隔(毫秒)，为0时不注册
+         */
+        void add(const void* key, std::function<void()> flush, uint32_t intervalMs);
+        /// @brief remove 注销刷新函数，正在调用时等待调用结束，返回后刷新函数不会再被调用
+        void remove(const void* key);
+        /// @brief flushAll 立即调用所有刷新函数
+        void flushAll();
+        /// @brief isExiting 进程是否正在退出，此时刷新需要等待异步写完成
+        bool isExiting() const {
+            return m_exiting.load(std::memory_order_relaxed);
+        }
+
+    private:
+        LogFlusher();
+        ~LogFlusher() = default;
+        void run();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        using FlushFunc = std::shared_ptr<const std::function<void()>>;
+        struct Entry {
+            FlushFunc flush;
+            Clock::duration interval;
+            Clock::time_point deadline;
+            bool running = false;           //刷新函数正在被调用，同一个key同时只有一个调用
+            std::thread::id runner;         //调用刷新函数的线程
+        };
+        struct Call {
+            const void* key;
+            FlushFunc flush;
+        };
+
+        /// @brief erase 等待key的刷新结束后删除，调用时持有lock
+        void erase(std::unique_lock<std::mutex>& lock, const void* key);
+        /// @brief call 不持锁调用刷新函数，结束后清除running标志，调用时持有lock
+        void call(std::unique_lock<std::mutex>& lock, const std::vector<Call>& calls);
+
+    private:
+        std::mutex m_mutex;     //保护m_entries，调用刷新函数时不持有
+        std::condition_variable m_cond;
+        std::condition_variable m_idle;     //有刷新函数调用结束
+        std::map<const void*, Entry> m_entries;
+        std::thread m_thread;
+        std::atomic<bool> m_exiting{false};
+};
+
+}
+
+#endif /* __FILEWRITER_HPP_ */
@@ -5,12 +5,21 @@
 #include <string>
 #include <vector>
 #include <ctime>
-#include <json/json.h>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <boost/utility/string_view.hpp>
 #include "loglevel.hpp"
 #include "logevent.hpp"
 
 namespace daq {
 
+/// @brief 日志格式
+///
+/// 构造时把格式字符串编译成一段扁平的指令序列，相邻的普通字符合并成一条指令。
+/// 格式化时顺序执行指令，直接追加到调用者提供的缓冲区，不使用iostream和虚函数。
+/// %d{...}中strftime的部分按秒缓存，同一秒内的事件只复制缓存的字符串;
+/// 另外支持%3N(毫秒)、%6N(微秒)、%9N或%N(纳秒)
 class Formatter {
     public:
         using sptr = std::shared_ptr<Formatter>;
@@ -22,6 +31,18 @@ class Formatter {
         ///
         /// \return 日志事件字符串
         virtual std::string format(LogEvent::sptr event);
+        /// \brief format 格式化日志事件到buffer，buffer会先被清空，其容量可以复用
+        ///
+        /// \param event 日志事件
+        /// \param buffer 输出缓冲区
+        ///
+        /// \return 指向buffer的视图，buffer修改前有效
+        boost::string_view format(const LogEvent& event, std::string& buffer) const;
+        /// \brief formatTo 把格式化结果追加到buffer末尾
+        ///
+        /// \param buffer 输出缓冲区
+        /// \param event 日志事件
+        void formatTo(std::string& buffer, const LogEvent& event) const;
 
     public:
         /**
@@ -34,6 +55,11 @@ class Formatter {
          * @brief 构造函数
          */
         Formatter() = default;
+        /**
+         * @brief 拷贝构造函数，时间缓存不拷贝
+         */
+        Formatter(const Formatter& rth);
+        Formatter& operator=(const Formatter& rth);
 
         /**
          * @brief 析构函数
@@ -45,141 +71,57 @@ class Formatter {
         }
 
     public:
-        /// @brief 格式化项
-        class FormatItem {
-            public:
-                using sptr = std::shared_ptr<FormatItem>;
-                FormatItem(const std::string& name): m_name(name) {}
+        /// @brief 格式化指令
+        enum class OpCode : uint8_t {
+            LITERAL,        ///普通字符串
+            MESSAGE,        ///%m
+            LEVEL,          ///%p
+            THREAD_ID,      ///%t
+            THREAD_NAME,    ///%h
+            DATE_TIME,      ///%d{...}中strftime的部分
+            SUB_SECOND,     ///%d{...}中的%3N %6N %9N
+            ELAPSED,        ///%r
+            FILE_NAME,      ///%f
+            LINE,           ///%l
+            FIBER_ID,       ///%F
+            CLASS_NAME,     ///%C
+            METHOD_NAME,    ///%M
+            LOGGER_NAME,    ///%N
+            NEW_LINE,       ///%n
+            TAB,            ///%T
+        };
 
-                virtual std::string getName() const {
-                    return m_name;
-                }
+        /// @brief 一条格式化指令，参数是m_strings中的一段
+        struct Op {
+            OpCode code;
+            uint32_t offset;
+            uint32_t length;
+            uint32_t arg;       ///DATE_TIME: 缓存下标; SUB_SECOND: 位数
+        };
 
-                virtual ~FormatItem() = default;
-                virtual void addFormat(std::ostream& os, LogEvent::sptr event) = 0;
-            protected:
-                std::string m_name = "";
+        /// @brief 一段时间格式按秒缓存的结果，用seqlock保证多线程安全
+        struct TimeCache {
+            static constexpr size_t WORDS = 8;
+            std::atomic<uint32_t> seq{0};       ///奇数表示正在写
+            std::atomic<int64_t> second{-1};    ///缓存对应的秒
+            std::atomic<uint32_t> length{0};
+            std::atomic<uint64_t> data[WORDS];  ///渲染结果，最多64字节
         };
 
     protected:
-        std::vector<FormatItem::sptr> m_items;
-        std::string m_pattern;
-};
-
-//Formatter::FormatItem
-/*******************************************************************************/
-class LoggerNameFormatItem : public Formatter::FormatItem {
-    public:
-        LoggerNameFormatItem(const std::string& name = "app_id"): FormatItem("app_id") {}
-        virtual void addFormat(std::ostream& os, LogEvent::sptr event) override {
-            os << event->getLoggerName();
-        }
-};
-
-class MessageFormatItem : public Formatter::FormatItem {
-    public:
-        MessageFormatItem(const std::string& name = "msg"): FormatItem("msg") {}
-        virtual void addFormat(std::ostream& os, LogEvent::sptr event) override {
-            os << event->getContent();
-        }
-};
-
-class LevelFormatItem : public Formatter::FormatItem {
-    public:
-        LevelFormatItem(const std::string& name = "level"): FormatItem("level") {}
-        virtual void addFormat(std::ostream& os, LogEvent::sptr event) override {
-            os << LoglevelToStr(event->getLevel());
-        }
-};
-
-class ThreadIdFormatItem : public Formatter::FormatItem {
-    public:
-        ThreadIdFormatItem(const std::string& name = "thread_id"): FormatItem("thread_id") {}
-        virtual void addFormat(std::ostream& os, LogEvent::sptr event) override {
-            os << event->getThreadId();
-        }
-};
-
-class DateTimeFormatItem : public Formatter::FormatItem {
-    public:
-        DateTimeFormatItem(const std::string& str = "")
-            : FormatItem("time"), m_fmt(str) {}
-        virtual void addFormat(std::ostream& os, LogEvent::sptr event) override {
-            time_t now = event->getTime();
-            struct tm * time = localtime(&now);
-            char buffer[128];
-            std::strftime(buffer, 128, m_fmt.c_str(), time);
-            os << buffer;
-        }
-
-    private:
-        std::string m_fmt;
-};
+        /// \brief addOp 添加一条指令，相邻的LITERAL会被合并
+        void addOp(OpCode code, const std::string& arg = "", uint32_t opArg = 0);
+        /// \brief addDateTime 编译%d{...}，拆分成strftime段和亚秒段
+        void addDateTime(const std::string& timeFmt);
+        /// \brief appendTime 追加一段strftime格式的时间，优先使用缓存
+        void appendTime(std::string& buffer, const Op& op, time_t second) const;
 
-class FileNameFormatItem : public Formatter::FormatItem {
-    public:
-        FileNameFormatItem(const std::string& name = "file_name"): FormatItem("file_name") {}
-        virtual void addFormat(std::ostream & os, LogEvent::sptr event) override {
-            os << event->getFileName();
-        }
-};
-
-class LineNumberFormatItem : public Formatter::FormatItem {
-    public:
-        LineNumberFormatItem(const std::string& name = "line"): FormatItem("line") {}
-        virtual void addFormat(std::ostream& os, LogEvent::sptr event) override {
-            os << event->getLineNumber();
-        }
-};
-
-class FiberFormatItem : public Formatter::FormatItem {
-    public:
-        FiberFormatItem(const std::string& name = "fiber_id"): FormatItem("fiber_id") {}
-        virtual void addFormat(std::ostream& os, LogEvent::sptr event) override {
-            os << event->getFiberId();
-        }
-};
-
-class ClassFormatItem : public Formatter::FormatItem {
-    public:
-        ClassFormatItem(const std::string& name = "class"): FormatItem("class") {}
-        virtual void addFormat(std::ostream& os, LogEvent::sptr event) override {
-            os << event->getClassName();
-        }
-};
-
-class MethodFormatItem : public Formatter::FormatItem {
-    public:
-        MethodFormatItem(const std::string& name = "method"): FormatItem("method") {}
-        virtual void addFormat(std::ostream& os, LogEvent::sptr event) override {
-            os << event->getMethodName();
-        }
-};
-
-class StrFormatItem : public Formatter::FormatItem {
-    public:
-        StrFormatItem(const std::string& str): FormatItem(""), m_str(str) {}
-        virtual void addFormat(std::ostream & os, LogEvent::sptr event) override {
-            os << m_str;
-        }
-    private:
-        std::string m_str;
-};
-
-class TabFormatItem : public Formatter::FormatItem {
-    public:
-        TabFormatItem(const std::string& name = ""): FormatItem("") {}
-        virtual void addFormat(std::ostream & os, LogEvent::sptr event) override {
-            os << "\t";
-        }
-};
-
-class NewLineFormatItem : public Formatter::FormatItem {
-    public:
-        NewLineFormatItem(const std::string& name = ""): FormatItem("") {}
-        virtual void addFormat(std::ostream & os, LogEvent::sptr event) override {
-            os << std::endl;
-        }
+    protected:
+        std::vector<Op> m_program;
+        std::string m_strings;      ///指令参数(普通字符串、时间格式)的存储区
+        std::string m_pattern;
+        size_t m_timeCacheCount = 0;
+        std::unique_ptr<TimeCache[]> m_timeCaches;
 };
 
 }
@@ -0,0 +1,230 @@
+#ifndef __HTTPSENDER_HPP_
+#define __HTTPSENDER_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <curl/curl.h>
+#include <boost/noncopyable.hpp>
+
+#include "spool.hpp"
+
+namespace daq {
+
+/// @brief HTTPAppender的批量发送策略，满足任一条件时发送一个请求
+struct HttpBatchPolicy {
+    size_t maxEvents = 1000;            ///一个请求最多的日志条数，1表示每条日志单独发送
+    size_t maxBytes = 1024 * 1024;      ///请求体(压缩前)的最大字节数
+    uint32_t maxAgeMs = 1000;           ///日志最多等待的毫秒数，0表示不按时间发送
+    bool gzip = false;                  ///gzip压缩请求体，并加上"Content-Encoding: gzip"；在HttpSender的I/O线程中压缩
+};
+
+/**
+ * @brief 把多条JSON格式的日志合并成一个JSON数组作为请求体
+ *
+ * Flume的HTTP source接受事件数组，jsonFormatter输出的如果已经是数组("[{...}]")，
+ * 合并时去掉外层的方括号。不是线程安全的，由HTTPAppender加锁
+ */
+class HttpBatch {
+    public:
+        HttpBatch() = default;
+        HttpBatch(const HttpBatch&) = delete;
+        HttpBatch& operator=(const HttpBatch&) = delete;
+
+        /**
+         * @brief add 加入一条日志
+         *
+         * @param data jsonFormatter格式化后的日志
+         * @param len 长度
+         */
+        void add(const char* data, size_t len);
+        /// @brief count 已经加入的日志条数
+        size_t count() const {
+            return m_count;
+        }
+        /// @brief bytes 请求体(压缩前)的字节数
+        size_t bytes() const {
+            return m_body.size() + 1;
+        }
+        bool empty() const {
+            return m_count == 0;
+        }
+
+        /**
+         * @brief take 结束这一批，取走请求体，之后批次为空
+         *
+         * @return 没有压缩的请求体
+         */
+        std::string take();
+
+    private:
+        std::string m_body;         //"[事件,事件"，take时补上"]"
+        size_t m_count = 0;
+};
+
+/// @brief HttpSender的发送策略
+struct HttpSendPolicy {
+    size_t maxInflight = 4;                     ///同时在发送的请求数，也是到服务器的最大连接数
+    size_t maxBacklog = 64 * 1024 * 1024;       ///等待发送的请求体总字节数上限，超出时丢弃最旧的请求
+    uint32_t timeoutMs = 10000;                 ///单个请求的超时，也是析构时等待发送完的最长时间
+    uint32_t retryMinMs = 100;                  ///第一次重试前等待的毫秒数，之后每次翻倍
+    uint32_t retryMaxMs = 30000;                ///重试等待的上限
+    uint32_t maxRetries = 0;                    ///每个请求最多重试的次数，0表示一直重试(受maxBacklog限制)
+    size_t spoolInflight = 1;                   ///同时发送的Spool中的请求数，1表示按顺序发送；
+                                                ///大于1时恢复更快，但新的请求直接发送，和Spool中的请求之间不保证顺序
+};
+
+/**
+ * @brief 基于curl multi的非阻塞HTTP发送器
+ *
+ * 调用者只把请求体放入队列，由发送器自己的I/O线程压缩和发出。multi句柄缓存keep-alive连接，
+ * 同时最多maxInflight个请求在发送。请求失败(连接错误、超时、408、429、5xx)时放回队首，
+ * 暂停发送并按指数退避等待后重试，成功后恢复；其他4xx不会重试，直接丢弃。
+ * 积压超过maxBacklog时丢弃最旧的请求，内存有上限。
+ *
+ * 设置了缓存目录时，服务器失败或者积压超过maxBacklog时，I/O线程把积压的请求写入Spool。
+ * 默认每次发送一个Spool中的请求，Spool发送完之前新的请求也写入Spool，保持顺序；
+ * spoolInflight大于1时服务器恢复并且积压低于maxBacklog后新的请求直接发送，
+ * 同时用最多spoolInflight个连接发送Spool中的请求(设置了drainRate时每次一个)。
+ * Spool中最旧的若干个请求都成功后才从Spool中取走。
+ * 析构时没有发送完的请求也写入Spool，下次启动时继续发送。服务器正常时不读写磁盘
+ */
+class HttpSender : public boost::noncopyable {
+    public:
+        /**
+         * @brief HttpSender 创建I/O线程
+         *
+         * @param url 地址
+         * @param policy 发送策略
+         * @param spool 本地缓存策略，目录为空时不缓存
+         */
+        HttpSender(const std::string& url, const HttpSendPolicy& policy = HttpSendPolicy(),
+                   const SpoolPolicy& spool = SpoolPolicy());
+        /// @brief 析构时最多等待timeoutMs把积压的请求发送完，剩下的丢弃或者写入Spool
+        ~HttpSender();
+
+        /**
+         * @brief post 把请求体交给I/O线程，不会阻塞
+         *
+         * @param body 没有压缩的JSON数组
+         * @param gzip 是否gzip压缩，在I/O线程中压缩，压缩失败时发送原文
+         */
+        void post(std::string&& body, bool gzip);
+
+        /**
+         * @brief waitIdle 等待所有请求发送完成(或者被丢弃、写入Spool)
+         *
+         * @param timeoutMs 最长等待的毫秒数
+         *
+         * @return 是否已经全部完成
+         */
+        bool waitIdle(uint32_t timeoutMs);
+
+        /// @brief pending 等待发送和正在发送的请求数
+        size_t pending();
+        /// @brief getSent 发送成功的请求数
+        uint64_t getSent();
+        /// @brief getDropped 丢弃的请求数
+        uint64_t getDropped();
+        /// @brief getSpool 本地缓存，没有设置时为nullptr
+        Spool* getSpool() {
+            return m_spool.get();
+        }
+        const HttpSendPolicy& getPolicy() const {
+            return m_policy;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        struct Request {
+            std::string body;
+            bool gzip;
+            uint32_t retries;
+            bool spooled;       //从Spool中读出，发送成功后才取走
+            uint64_t spoolSeq;  //Spool中的请求的序号，对应m_spoolSlots中的一项
+            bool compress;      //还需要在I/O线程中压缩，压缩后gzip为true
+            uint64_t seq;       //post的顺序，失败时按它放回m_queue
+        };
+        using RequestQueue = std::deque<std::unique_ptr<Request>>;
+        /// Spool中从最旧的一条开始已经读出的请求的状态
+        struct SpoolSlot {
+            bool inflight;
+            bool done;          //成功或者不再重试，等前面的都完成后从Spool中取走
+            uint32_t retries;
+        };
+
+        void run();
+        /// @brief start 把请求加入multi句柄，调用时持有m_mutex
+        bool start(std::unique_ptr<Request> request);
+        /// @brief complete 处理完成的请求
+        void complete(CURL* easy, CURLcode result);
+        /// @brief drop 丢弃请求并计数，调用时持有m_mutex
+        void drop(size_t count, const char* reason);
+        /// @brief idle 除了Spool以外没有等待和正在发送的请求，调用时持有m_mutex
+        bool idle() const {
+            return m_posted.empty() && m_queue.empty() && m_spilling == 0 && m_inflight == m_spoolInflight;
+        }
+        /// @brief takePosted 取出新的请求，在锁外压缩后放入m_queue，只在I/O线程中调用
+        void takePosted();
+        /// @brief compress gzip压缩请求体，失败时请求不变
+        void compress(Request& request);
+        /// @brief spill 把请求写入Spool，不持有m_mutex，只在I/O线程中调用
+        void spill(RequestQueue& requests);
+        /// @brief drainSpool 用空闲的连接发送Spool中的请求，返回需要等待的毫秒数
+        int drainSpool();
+        /// @brief syncSpool Spool删除了未读完的段时，已经读出的请求作废
+        void syncSpool();
+        /// @brief completeSpooled 记录Spool中的请求的结果，取走最前面完成的请求
+        void completeSpooled(const Request& request, bool retry);
+
+    private:
+        std::string m_url;
+        HttpSendPolicy m_policy;
+        CURLM* m_multi = nullptr;
+        struct curl_slist* m_headers = nullptr;
+        struct curl_slist* m_gzipHeaders = nullptr;     //多一个Content-Encoding
+        std::vector<CURL*> m_idle;                      //可以复用的easy句柄，只在I/O线程中使用
+        std::unordered_map<CURL*, std::unique_ptr<Request>> m_active;  //正在发送的请求
+        std::unique_ptr<Spool> m_spool;
+        std::deque<SpoolSlot> m_spoolSlots;             //只在I/O线程中使用
+        uint64_t m_spoolBase = 0;                       //m_spoolSlots第一项的序号
+        uint64_t m_spoolLost = 0;                       //读出m_spoolSlots时Spool的lostSegments
+        struct Deflater;
+        std::unique_ptr<Deflater> m_deflater;           //复用的zlib压缩流，第一次压缩时创建
+        std::string m_gzip;                             //压缩的输出缓冲区，和请求体交换后复用
+
+        std::mutex m_mutex;                             //保护以下成员
+        std::condition_variable m_idleCond;
+        RequestQueue m_posted;                          //post放入，还没有压缩的请求
+        RequestQueue m_queue;                           //等待发送的请求
+        size_t m_queuedBytes = 0;                       //m_posted和m_queue的字节数
+        uint64_t m_postSeq = 0;                         //下一个post的请求的序号
+        size_t m_spilling = 0;                          //已经从m_queue取出、正在写入Spool的请求数
+        size_t m_inflight = 0;                          //包括Spool中的请求
+        size_t m_spoolInflight = 0;                     //正在发送的Spool中的请求数
+        uint32_t m_failures = 0;                        //连续退避的次数
+        Clock::time_point m_backoffUntil;               //退避结束的时刻，之前不发送新的请求
+        Clock::time_point m_lastDropReport;
+        uint64_t m_sent = 0;
+        uint64_t m_dropped = 0;
+        uint64_t m_reported = 0;                        //已经打印过的丢弃数
+        bool m_stop = false;
+        Clock::time_point m_stopDeadline;
+        std::minstd_rand m_random;                      //退避时间的抖动
+
+        std::thread m_thread;
+};
+
+}
+
+#endif /* __HTTPSENDER_HPP_ */
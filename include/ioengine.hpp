@@ -0,0 +1,76 @@
+#ifndef __IOENGINE_HPP_
+#define __IOENGINE_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <sys/types.h>
+#include <boost/noncopyable.hpp>
+
+namespace daq {
+
+/**
+ * @brief 异步写文件的引擎，FileWriter在FlushPolicy::asyncDepth不为0时使用
+ *
+ * 写请求按缓冲区下标提交，完成后由调用者取回，同一时刻可以有多个请求在写。
+ * 有io_uring时在调用线程中批量提交、收割完成事件，不需要额外的线程，缓冲区注册为固定缓冲区；
+ * 内核不支持(或者编译时定义了DAQ_LOG_NO_IO_URING)时退回到进程内共享的写线程池。
+ * 不是线程安全的，由FileWriter的调用者加锁
+ */
+class IoEngine : public boost::noncopyable {
+    public:
+        /// @brief 一个完成的写请求
+        struct Completion {
+            unsigned index;     ///缓冲区下标
+            ssize_t result;     ///写入的字节数，失败时为-errno
+        };
+
+        /**
+         * @brief create 创建引擎，优先使用io_uring
+         *
+         * @param buffers 所有缓冲区，提交时用下标指定
+         * @param bufferSize 每个缓冲区的大小
+         *
+         * @return 引擎
+         */
+        static std::unique_ptr<IoEngine> create(const std::vector<char*>& buffers, size_t bufferSize);
+
+        virtual ~IoEngine() = default;
+
+        /**
+         * @brief submit 提交一个写请求，io_uring可能推迟到下一次reap时才真正提交
+         *
+         * @param fd 文件
+         * @param index 缓冲区下标
+         * @param len 长度
+         * @param offset 文件中的偏移
+         */
+        virtual void submit(int fd, unsigned index, size_t len, uint64_t offset) = 0;
+
+        /**
+         * @brief reap 提交推迟的请求并取回已经完成的请求
+         *
+         * @param done 输出
+         * @param max done的长度
+         * @param wait 为true时至少等到一个请求完成
+         *
+         * @return 取回的个数
+         */
+        virtual size_t reap(Completion* done, size_t max, bool wait) = 0;
+
+        /// @brief name 引擎的名字，"io_uring"或者"threads"
+        virtual const char* name() const = 0;
+};
+
+/**
+ * @brief pwriteAll 在指定偏移写出全部数据，处理EINTR和部分写入
+ *
+ * @return 写入的字节数，失败时为-errno
+ */
+ssize_t pwriteAll(int fd, const char* data, size_t len, uint64_t offset);
+
+}
+
+#endif /* __IOENGINE_HPP_ */
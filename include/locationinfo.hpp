@@ -2,9 +2,17 @@
 #define __LOCATIONINFO_HPP_
 
 #include <string>
+#include <cstddef>
+#include <boost/utility/string_view.hpp>
+
+#include "loglevel.hpp"
 
 namespace daq {
 
+/// @brief 调用点信息
+///
+/// 由LOCATIONINFO宏在每个调用点生成一个静态的constexpr对象，文件名、类名、方法名
+/// 在编译期从__FILE__和__PRETTY_FUNCTION__中解析出来，日志事件只保存它的指针
 class LocationInfo {
     public:
         /*
@@ -18,13 +26,34 @@ class LocationInfo {
         /// @return LocationInfo
         static const LocationInfo& getLocationUnavailable();
 
-
-
-        LocationInfo( const char* const fileName,
-                      const char* const functionName,
-                      int lineNumber);
+        /// @brief 构造函数
+        ///
+        /// @param fileName 文件名
+        /// @param functionName 函数名(__PRETTY_FUNCTION__)
+        /// @param lineNumber 行号
+        /// @param level 调用点的日志级别
+        /// @param format 调用点的格式字符串
+        /// @param persistent 对象是否在程序运行期间一直存在，为true时日志事件只保存指针
+        constexpr LocationInfo(const char* const fileName,
+                               const char* const functionName,
+                               int lineNumber,
+                               LogLevel level = LogLevel::TRACE,
+                               const char* const format = nullptr,
+                               bool persistent = false)
+            : m_lineNumber(lineNumber),
+              m_fileName(fileName),
+              m_methodName(functionName),
+              m_baseName(fileName + baseNameOffset(fileName)),
+              m_className(parseClassName(functionName)),
+              m_classLength(parseClassLength(functionName)),
+              m_method(functionName + parseMethodOffset(functionName)),
+              m_methodLength(length(functionName) - parseMethodOffset(functionName)),
+              m_level(level),
+              m_format(format),
+              m_persistent(persistent) {}
 
         LocationInfo();
+        /// 拷贝得到的对象不再是persistent
         LocationInfo(const LocationInfo& src);
         LocationInfo& operator=(const LocationInfo& src);
         LocationInfo& operator=(const LocationInfo&& src);
@@ -36,18 +65,119 @@ class LocationInfo {
         int getLineNumber() const;
         const std::string getMethodName() const;
 
+        /// @brief getClassNameView 类名，不分配内存
+        boost::string_view getClassNameView() const {
+            return boost::string_view(m_className, m_classLength);
+        }
+        /// @brief getMethodNameView 方法名，不分配内存
+        boost::string_view getMethodNameView() const {
+            return boost::string_view(m_method, m_methodLength);
+        }
+        /// @brief getBaseName 不含目录的文件名
+        const char* getBaseName() const {
+            return m_baseName;
+        }
+        /// @brief getLevel 调用点的日志级别
+        LogLevel getLevel() const {
+            return m_level;
+        }
+        /// @brief getFormat 调用点的格式字符串，没有时为nullptr
+        const char* getFormat() const {
+            return m_format;
+        }
+        /// @brief isPersistent 对象是否一直存在(LOCATIONINFO生成的静态对象)
+        bool isPersistent() const {
+            return m_persistent;
+        }
+
+    private:
+        //编译期解析__FILE__和__PRETTY_FUNCTION__
+        static constexpr size_t length(const char* str) {
+            size_t i = 0;
+            while (str[i]) {
+                ++i;
+            }
+            return i;
+        }
+        static constexpr size_t find(const char* str, char c, size_t end) {
+            for (size_t i = 0; i < end; ++i) {
+                if (str[i] == c) {
+                    return i;
+                }
+            }
+            return end;
+        }
+        static constexpr size_t findColons(const char* str) {
+            for (size_t i = 0; str[i]; ++i) {
+                if (str[i] == ':' && str[i + 1] == ':') {
+                    return i;
+                }
+            }
+            return size_t(-1);
+        }
+        static constexpr size_t baseNameOffset(const char* path) {
+            size_t offset = 0;
+            for (size_t i = 0; path[i]; ++i) {
+                if (path[i] == '/') {
+                    offset = i + 1;
+                }
+            }
+            return offset;
+        }
+        /// 方法名: 第一个"::"之后的部分，没有"::"时为第一个空格之后的部分
+        static constexpr size_t parseMethodOffset(const char* func) {
+            size_t colonPos = findColons(func);
+            if (colonPos != size_t(-1)) {
+                return colonPos + 2;
+            }
+            size_t len = length(func);
+            size_t spacePos = find(func, ' ', len);
+            return spacePos == len ? 0 : spacePos + 1;
+        }
+        /// 类名: 第一个"::"之前最后一个空格之后的部分，没有"::"时为"??"
+        static constexpr size_t parseClassOffset(const char* func) {
+            size_t colonPos = findColons(func);
+            size_t offset = 0;
+            for (size_t i = 0; i < colonPos; ++i) {
+                if (func[i] == ' ') {
+                    offset = i + 1;
+                }
+            }
+            return offset;
+        }
+        static constexpr const char* parseClassName(const char* func) {
+            return findColons(func) == size_t(-1) ? "??" : func + parseClassOffset(func);
+        }
+        static constexpr size_t parseClassLength(const char* func) {
+            return findColons(func) == size_t(-1) ? 2 : findColons(func) - parseClassOffset(func);
+        }
 
     private:
         int m_lineNumber;
         const char* m_fileName;
         const char* m_methodName;
+        const char* m_baseName;
+        const char* m_className;
+        size_t m_classLength;
+        const char* m_method;
+        size_t m_methodLength;
+        LogLevel m_level;
+        const char* m_format;
+        bool m_persistent;
 };
 
 }
 
 /*
- * 产生代码位置消息的宏
+ * 产生代码位置消息的宏，每个调用点一个静态对象，使用GNU语句表达式以保留所在函数的__PRETTY_FUNCTION__
  */
-#define LOCATIONINFO LocationInfo(__FILE__, __PRETTY_FUNCTION__, __LINE__)
+#define DAQ_LOCATION_SITE(level, fmt) \
+    (*({ \
+        static constexpr ::daq::LocationInfo daq_location_site_(__FILE__, __PRETTY_FUNCTION__, __LINE__, \
+                                                                 level, fmt, true); \
+        &daq_location_site_; \
+    }))
+
+#define LOCATIONINFO DAQ_LOCATION_SITE(::daq::LogLevel::TRACE, nullptr)
 
 #endif /*__LOCATIONINFO_HPP_*/
@@ -0,0 +1,55 @@
+#ifndef __LOGCLOCK_HPP_
+#define __LOGCLOCK_HPP_
+
+#include <cstdint>
+#include <atomic>
+
+namespace daq {
+
+/// @brief 日志时间戳的时钟源
+///
+/// 单次调用的大致开销(x86_64, Linux vDSO):
+///     REALTIME          ~20ns，纳秒精度
+///     REALTIME_COARSE   ~5ns， 精度为一个jiffy(1-4ms)
+///     TSC               ~8ns， 纳秒精度，按REALTIME校准并每秒重新同步
+enum class ClockSource {
+    REALTIME = 0,           ///clock_gettime(CLOCK_REALTIME)
+    REALTIME_COARSE = 1,    ///clock_gettime(CLOCK_REALTIME_COARSE)
+    TSC = 2,                ///rdtsc换算成墙上时间，CPU不支持invariant TSC时退回REALTIME
+};
+
+/// @brief 日志使用的时钟，所有时钟源都返回自1970-01-01起的纳秒数
+class LogClock {
+    public:
+        /// @brief now 当前时间
+        ///
+        /// @return 纳秒
+        static uint64_t now();
+
+        /// @brief setSource 选择时钟源，全局生效;选择TSC时会阻塞约10ms做校准
+        ///
+        /// @param source 时钟源
+        static void setSource(ClockSource source);
+
+        /// @brief getSource 当前使用的时钟源
+        ///
+        /// @return 时钟源
+        static ClockSource getSource() {
+            return s_source.load(std::memory_order_relaxed);
+        }
+
+        /// @brief getStartTime 程序启动(加载日志库)的时间
+        ///
+        /// @return 纳秒
+        static uint64_t getStartTime();
+
+    private:
+        static uint64_t tscNow();
+
+    private:
+        static std::atomic<ClockSource> s_source;
+};
+
+}
+
+#endif /*__LOGCLOCK_HPP_*/
@@ -0,0 +1,96 @@
+#ifndef __LOGCOMPRESSOR_HPP_
+#define __LOGCOMPRESSOR_HPP_
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+#include <boost/noncopyable.hpp>
+
+namespace daq {
+
+/// @brief 滚动后文件的压缩方式
+enum class Compression {
+    NONE = 0,
+    GZIP = 1,       ///zlib，输出"文件名.gz"
+    ZSTD = 2,       ///编译时没有zstd(DAQ_LOG_HAS_ZSTD)时使用GZIP
+};
+
+/**
+ * @brief 后台压缩已经关闭的日志文件，也执行清理等其他后台文件操作
+ *
+ * submit只把任务放入队列，不会阻塞调用者。压缩线程按需创建，个数不超过setMaxThreads的值，
+ * 线程的CPU和IO优先级都设为最低，避免和数据获取争抢资源。
+ * 压缩先写到"目标文件名.tmp"，完成后rename成目标文件名，再删除原文件；
+ * 失败时删除临时文件，保留原文件
+ */
+class LogCompressor : public boost::noncopyable {
+    public:
+        /// 压缩完成的回调，参数为原文件名和压缩后的文件名(失败时为原文件名)
+        using Callback = std::function<void(const std::string&, const std::string&)>;
+
+        static LogCompressor* instance();
+
+        /**
+         * @brief submit 提交一个压缩任务
+         *
+         * @param path 已经关闭的文件
+         * @param compression 压缩方式，NONE时直接调用回调
+         * @param done 完成后在压缩线程中调用，可以为空
+         */
+        void submit(const std::string& path, Compression compression, Callback done = Callback());
+
+        /**
+         * @brief post 在压缩线程中执行其他后台文件操作(如清理旧文件)，同样不阻塞调用者
+         *
+         * @param job 任务
+         */
+        void post(std::function<void()> job);
+
+        /**
+         * @brief setMaxThreads 设置同时压缩的最大线程数，默认1
+         *
+         * @param count 线程数，至少为1
+         */
+        void setMaxThreads(size_t count);
+
+        /// @brief pending 还没有完成的任务数
+        size_t pending();
+
+        /// @brief getSuffix 压缩方式对应的文件后缀
+        static const char* getSuffix(Compression compression);
+
+    private:
+        LogCompressor() = default;
+        ~LogCompressor() = default;
+        void run();
+        /// @brief compress 压缩一个文件，返回压缩后的文件名，失败时返回空
+        static std::string compress(const std::string& path, Compression compression);
+
+    private:
+        struct Task {
+            std::string path;
+            Compression compression;
+            Callback done;
+            std::function<void()> job;      //不为空时是post提交的任务
+        };
+
+        /// @brief push 把任务放入队列，需要时创建线程，调用时持有m_mutex
+        void push(Task&& task);
+
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::deque<Task> m_tasks;
+        size_t m_maxThreads = 1;
+        size_t m_threads = 0;       //已经创建的线程数
+        size_t m_idle = 0;          //空闲的线程数
+        size_t m_running = 0;       //正在执行的任务数
+};
+
+}
+
+#endif /* __LOGCOMPRESSOR_HPP_ */
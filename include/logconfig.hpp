@@ -4,9 +4,21 @@
 #include <string>
 #include <vector>
 #include "loglevel.hpp"
+#include "filewriter.hpp"
+#include "segmentlist.hpp"
+#include "logcompressor.hpp"
+#include "httpsender.hpp"
+#include "zmqbatch.hpp"
 
 namespace daq {
 
+/// @brief 异步logger后台线程在队列为空时的等待策略
+enum class WaitStrategy {
+    SPIN = 0,   ///一直自旋，延迟最低，但独占一个核
+    YIELD = 1,  ///自旋后让出CPU
+    BLOCK = 2,  ///自旋、让出CPU后挂起在条件变量上，空闲时几乎不占CPU
+};
+
 /// @brief 配置log的结构体，包含所有能够配置的选项
 typedef struct LogConfigStruct {
     public:
@@ -38,6 +50,16 @@ typedef struct LogConfigStruct {
             this->port = rth.port;
             this->rollFileSize = rth.rollFileSize;
             this->asyncBufferSize  = rth.asyncBufferSize;
+            this->waitStrategy = rth.waitStrategy;
+            this->deferredFormat = rth.deferredFormat;
+            this->flushPolicy = rth.flushPolicy;
+            this->rollPeriod = rth.rollPeriod;
+            this->retention = rth.retention;
+            this->compression = rth.compression;
+            this->httpBatch = rth.httpBatch;
+            this->httpSend = rth.httpSend;
+            this->spool = rth.spool;
+            this->zmqSend = rth.zmqSend;
             this->outputLevel = rth.outputLevel;
 
             return *this;
@@ -60,6 +82,16 @@ typedef struct LogConfigStruct {
             this->port = rth.port;
             this->rollFileSize = rth.rollFileSize;
             this->asyncBufferSize  = rth.asyncBufferSize;
+            this->waitStrategy = rth.waitStrategy;
+            this->deferredFormat = rth.deferredFormat;
+            this->flushPolicy = rth.flushPolicy;
+            this->rollPeriod = rth.rollPeriod;
+            this->retention = rth.retention;
+            this->compression = rth.compression;
+            this->httpBatch = rth.httpBatch;
+            this->httpSend = rth.httpSend;
+            this->spool = rth.spool;
+            this->zmqSend = rth.zmqSend;
             this->outputLevel = rth.outputLevel;
 
             return *this;
@@ -78,6 +110,16 @@ typedef struct LogConfigStruct {
         std::string inetAddr = "";
         size_t port = 0;
         size_t asyncBufferSize = 0;
+        WaitStrategy waitStrategy = WaitStrategy::BLOCK;
+        bool deferredFormat = false;
+        FlushPolicy flushPolicy;            ///文件appender的刷新策略
+        RollPeriod rollPeriod = RollPeriod::NONE;           ///RollFileAppender按时间滚动的周期
+        RetentionPolicy retention;                          ///RollFileAppender和MmapFileAppender的保留策略
+        Compression compression = Compression::NONE;        ///RollFileAppender滚动后文件的压缩方式
+        HttpBatchPolicy httpBatch;          ///HTTPAppender的批量发送策略
+        HttpSendPolicy httpSend;            ///HTTPAppender的发送、重试和积压策略
+        SpoolPolicy spool;                  ///HTTPAppender和ZMQAppender的本地缓存策略
+        ZmqSendPolicy zmqSend;              ///ZMQAppender的批量发送和套接字选项
         LogLevel outputLevel = LogLevel::TRACE;
 } log_config_t;
 
@@ -5,30 +5,67 @@
 #include <thread>
 #include <iostream>
 #include <string>
-#include <sstream>
 #include <memory>
-#include <sys/syscall.h>
-#include <unistd.h>
+#include <atomic>
 
-#include <boost/fiber/all.hpp>
+#include <boost/smart_ptr/intrusive_ptr.hpp>
 
 #include "locationinfo.hpp"
 #include "loglevel.hpp"
+#include "logclock.hpp"
+#include "logformat.hpp"
 
-#define _GNU_SOURCE
+namespace daq {
 
+class LogEventPool;
 
-namespace daq {
 /**
  * @brief 日志事件
  */
 class LogEvent {
     public:
-        using sptr = std::shared_ptr<LogEvent>;
+        /// 侵入式引用计数，引用为0时回收到所属的LogEventPool
+        using sptr = boost::intrusive_ptr<LogEvent>;
         LogEvent();
         LogEvent(const std::string& LoggerName, LogLevel level,
                  const std::string& msg, const LocationInfo& locationInfo);
+        LogEvent(const LogEvent&) = delete;
+        LogEvent& operator=(const LogEvent&) = delete;
         ~LogEvent() {}
+
+        /**
+         * @brief create 从当前线程的LogEventPool取出一个事件并填充
+         *
+         * 事件对象和其中字符串的容量都会被复用，稳定状态下不分配堆内存
+         *
+         * @param loggerName logger名字
+         * @param level 日志级别
+         * @param msg 日志内容
+         * @param locationInfo 位置信息
+         *
+         * @return 日志事件
+         */
+        static sptr create(const std::string& loggerName, LogLevel level,
+                           const std::string& msg, const LocationInfo& locationInfo);
+        /**
+         * @brief create 从当前线程的LogEventPool取出一个内容为空的事件，
+         *        内容由调用者通过getContentBuffer()直接写入
+         */
+        static sptr create(const std::string& loggerName, LogLevel level,
+                           const LocationInfo& locationInfo);
+
+        friend void intrusive_ptr_add_ref(LogEvent* event) {
+            event->m_refCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        friend void intrusive_ptr_release(LogEvent* event) {
+            if (event->m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                recycle(event);
+            }
+        }
+
+    private:
+        static void recycle(LogEvent* event);
+
     public:
         const LogLevel getLevel() const {
             return m_level;
@@ -36,24 +73,77 @@ class LogEvent {
         void setLevel(LogLevel level) {
             m_level = level;
         }
-        static uint32_t getThreadId() {
-            std::ostringstream oss;
-            oss << syscall(__NR_gettid);
-            uint32_t tid = std::stoull(oss.str());
-            return tid;
+        /// @brief getThreadId 产生事件的线程id
+        uint32_t getThreadId() const {
+            return m_threadId;
+        }
+        /// @brief getThreadName 产生事件的线程名
+        const char* getThreadName() const {
+            return m_threadName;
         }
-        static std::string getFiberId() {
-            std::stringstream ss;
-            ss << boost::this_fiber::get_id();
-            return ss.str();
+        /// @brief getFiber 产生事件的协程，即boost::fibers::context*，未记录时为空
+        const void* getFiber() const {
+            return m_fiber;
         }
-        static uint64_t getTime() {
-            return time(0);
+        /// @brief getFiberId 产生事件的协程id，与boost::this_fiber::get_id()的输出一致
+        std::string getFiberId() const;
+
+        /// @brief currentThreadId 当前线程id，第一次调用后缓存在线程局部变量中
+        static uint32_t currentThreadId();
+        /// @brief currentThreadName 当前线程名，第一次调用后缓存在线程局部变量中
+        static const char* currentThreadName();
+        /// @brief setCurrentThreadName 设置当前线程名，同时修改系统中的线程名
+        ///
+        /// @param name 线程名，超过15个字符的部分被截断
+        static void setCurrentThreadName(const std::string& name);
+        /// @brief setCaptureFiber 是否在产生事件时记录协程，格式中有%F时由Formatter打开
+        static void setCaptureFiber(bool capture) {
+            s_captureFiber.store(capture, std::memory_order_relaxed);
+        }
+
+        /// @brief getTime 事件产生的时间，秒
+        uint64_t getTime() const {
+            return m_timestamp / 1000000000;
+        }
+        /// @brief getTimestamp 事件产生的时间，自1970-01-01起的纳秒数
+        uint64_t getTimestamp() const {
+            return m_timestamp;
+        }
+        void setTimestamp(uint64_t timestamp) {
+            m_timestamp = timestamp;
         }
-        const std::string getContent() const {
+        /// @brief getStartTime 程序启动(加载日志库)的时间，纳秒
+        static uint64_t getStartTime() {
+            return LogClock::getStartTime();
+        }
+        const std::string& getContent() const {
+            return m_content;
+        }
+        /// @brief getContentBuffer 日志内容的缓冲区，用于直接格式化到事件中
+        std::string& getContentBuffer() {
             return m_content;
         }
-        std::string getLoggerName() const {
+        /// @brief getArgsBuffer 延迟格式化时保存参数字节的缓冲区
+        std::string& getArgsBuffer() {
+            return m_args;
+        }
+        /// @brief setArgsDecoder 设置延迟格式化的函数，格式字符串取自调用点的LocationInfo
+        void setArgsDecoder(ArgsDecoder decoder) {
+            m_argsDecoder = decoder;
+        }
+        /// @brief isDeferred 内容是否还没有格式化
+        bool isDeferred() const {
+            return m_argsDecoder != nullptr;
+        }
+        /// @brief renderContent 把延迟保存的参数格式化到日志内容中，由AsLogger后台线程调用
+        void renderContent() {
+            if (m_argsDecoder) {
+                m_content.clear();
+                m_argsDecoder(m_content, m_location->getFormat(), m_args.data());
+                m_argsDecoder = nullptr;
+            }
+        }
+        const std::string& getLoggerName() const {
             return m_loggerName;
         }
         void setLoggerName(const std::string& name) {
@@ -61,22 +151,101 @@ class LogEvent {
         }
 
         const char* getFileName() const {
-            return m_locationInfo.getFileName();
+            return m_location->getFileName();
         }
         int getLineNumber() const {
-            return m_locationInfo.getLineNumber();
+            return m_location->getLineNumber();
         }
         const std::string getClassName() const {
-            return m_locationInfo.getClassName();
+            return m_location->getClassName();
         }
         const std::string getMethodName() const {
-            return m_locationInfo.getMethodName();
+            return m_location->getMethodName();
+        }
+        /// @brief getLocationInfo 调用点信息
+        const LocationInfo& getLocationInfo() const {
+            return *m_location;
+        }
+        /// @brief setLocationInfo 设置调用点信息，LOCATIONINFO生成的静态对象只保存指针，
+        ///        其他的复制到事件外单独分配的副本中，副本随事件留在池中复用
+        void setLocationInfo(const LocationInfo& locationInfo) {
+            if (locationInfo.isPersistent()) {
+                m_location = &locationInfo;
+            } else {
+                if (!m_locationCopy) {
+                    m_locationCopy.reset(new LocationInfo(locationInfo));
+                } else {
+                    *m_locationCopy = locationInfo;
+                }
+                m_location = m_locationCopy.get();
+            }
         }
     private:
         std::string m_loggerName = "root";       //logger名字
         LogLevel m_level = LogLevel::TRACE;      //日志级别
+        uint64_t m_timestamp = 0;                //产生时间，纳秒
+        uint32_t m_threadId = 0;                 //线程id
+        char m_threadName[16] = {0};             //线程名
+        const void* m_fiber = nullptr;           //协程
         std::string m_content;		             //日志内容
-        const LocationInfo m_locationInfo;		 //位置信息
+        std::string m_args;                      //延迟格式化的参数
+        ArgsDecoder m_argsDecoder = nullptr;     //延迟格式化的函数，为空时m_content有效
+        const LocationInfo* m_location = &LocationInfo::getLocationUnavailable(); //位置信息
+        std::unique_ptr<LocationInfo> m_locationCopy; //非静态位置信息的副本，第一次用到时分配
+
+        std::atomic<uint32_t> m_refCount{0};     //引用计数
+        LogEventPool* m_pool = nullptr;          //所属的池，为空时直接delete
+        LogEvent* m_next = nullptr;              //池中空闲链表的下一个
+
+        static std::atomic<bool> s_captureFiber;
+
+        friend class LogEventPool;
+};
+
+/**
+ * @brief 每个线程一个的LogEvent池
+ *
+ * 只有所属线程从池中取事件。所属线程释放的事件放回本地空闲链表；
+ * 其他线程(如AsLogger后台线程)释放的事件无锁地压入远端链表，
+ * 所属线程本地链表为空时一次性取走。
+ * 空闲事件最多保留MAX_FREE个，多出的直接释放；内容的容量超过MAX_KEPT_CAPACITY时
+ * 归还时释放字符串，突发的大量或很长的日志过后不会一直占用内存。
+ * 线程退出后池会一直保留到最后一个在外的事件被释放。
+ */
+class LogEventPool {
+    public:
+        /// @brief local 当前线程的池
+        ///
+        /// @return LogEventPool*
+        static LogEventPool* local();
+
+        /// @brief acquire 取出一个事件，只能由所属线程调用
+        ///
+        /// @return 引用计数为0的事件
+        LogEvent* acquire();
+
+        /// @brief release 归还一个事件，可以由任意线程调用
+        ///
+        /// @param event 引用计数已经为0的事件
+        void release(LogEvent* event);
+
+        static constexpr size_t MAX_FREE = 1024;             ///每个池最多保留的空闲事件数
+        static constexpr size_t MAX_KEPT_CAPACITY = 4096;    ///归还时保留的字符串容量上限
+
+    private:
+        LogEventPool() = default;
+        ~LogEventPool();
+        /// @brief unref 减少池的引用，为0时释放池和其中所有事件
+        void unref();
+
+    private:
+        LogEvent* m_localHead = nullptr;              //所属线程使用的空闲链表
+        size_t m_localCount = 0;                      //本地空闲链表的长度
+        std::atomic<LogEvent*> m_remoteHead{nullptr}; //其他线程归还的空闲链表
+        std::atomic<size_t> m_remoteCount{0};         //远端链表的长度，只用于限制数量，可以不精确
+        std::atomic<size_t> m_refCount{1};            //所属线程 + 在外的事件数
+
+        friend struct LogEventPoolHolder;
 };
 
 }
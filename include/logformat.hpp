@@ -0,0 +1,354 @@
+#ifndef __LOGFORMAT_HPP_
+#define __LOGFORMAT_HPP_
+
+#include <string>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <boost/utility/string_view.hpp>
+
+namespace daq {
+
+/// @brief checkFormat 编译期检查"{}"风格的格式字符串
+///
+/// 支持"{{"和"}}"转义，占位符只能是"{}"
+///
+/// @param fmt 格式字符串
+/// @param argCount 参数个数
+///
+/// @return 格式合法且占位符个数等于参数个数时返回true
+constexpr bool checkFormat(const char* fmt, size_t argCount) {
+    size_t count = 0;
+    for (size_t i = 0; fmt[i]; ++i) {
+        if (fmt[i] == '{') {
+            if (fmt[i + 1] == '{') {
+                ++i;
+            } else if (fmt[i + 1] == '}') {
+                ++count;
+                ++i;
+            } else {
+                return false;
+            }
+        } else if (fmt[i] == '}') {
+            if (fmt[i + 1] != '}') {
+                return false;
+            }
+            ++i;
+        }
+    }
+    return count == argCount;
+}
+
+/// @brief formatArgCounter 只用于sizeof，在不求值参数的情况下得到参数个数加1
+template<typename... Args>
+char (&formatArgCounter(const Args&...))[sizeof...(Args) + 1];
+
+/// @brief appendUInt 把无符号整数追加到buffer
+inline void appendUInt(std::string& buffer, uint64_t value) {
+    char tmp[20];
+    char* end = tmp + sizeof(tmp);
+    char* p = end;
+    do {
+        *--p = char('0' + value % 10);
+        value /= 10;
+    } while (value);
+    buffer.append(p, end - p);
+}
+
+/// @brief appendInt 把有符号整数追加到buffer
+inline void appendInt(std::string& buffer, int64_t value) {
+    if (value < 0) {
+        buffer.push_back('-');
+        appendUInt(buffer, 0 - uint64_t(value));
+    } else {
+        appendUInt(buffer, uint64_t(value));
+    }
+}
+
+/// @brief appendHex 按operator<<(void*)的格式追加指针
+inline void appendHex(std::string& buffer, uintptr_t value) {
+    static const char s_hex[] = "0123456789abcdef";
+    char tmp[18];
+    char* end = tmp + sizeof(tmp);
+    char* p = end;
+    do {
+        *--p = s_hex[value & 0xf];
+        value >>= 4;
+    } while (value);
+    *--p = 'x';
+    *--p = '0';
+    buffer.append(p, end - p);
+}
+
+//各种类型参数的输出
+/*******************************************************************************/
+inline void appendArg(std::string& buffer, bool value) {
+    buffer.append(value ? "true" : "false");
+}
+
+inline void appendArg(std::string& buffer, char value) {
+    buffer.push_back(value);
+}
+
+inline void appendArg(std::string& buffer, const char* value) {
+    buffer.append(value ? value : "(null)");
+}
+
+inline void appendArg(std::string& buffer, char* value) {
+    appendArg(buffer, static_cast<const char*>(value));
+}
+
+inline void appendArg(std::string& buffer, const std::string& value) {
+    buffer.append(value);
+}
+
+inline void appendArg(std::string& buffer, boost::string_view value) {
+    buffer.append(value.data(), value.size());
+}
+
+//浮点数按能还原出原值的精度输出，double为17位，float为9位
+inline void appendArg(std::string& buffer, double value) {
+    char tmp[32];
+    int len = snprintf(tmp, sizeof(tmp), "%.17g", value);
+    buffer.append(tmp, len);
+}
+
+inline void appendArg(std::string& buffer, float value) {
+    char tmp[32];
+    int len = snprintf(tmp, sizeof(tmp), "%.9g", double(value));
+    buffer.append(tmp, len);
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+appendArg(std::string& buffer, T value) {
+    appendInt(buffer, value);
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type
+appendArg(std::string& buffer, T value) {
+    appendUInt(buffer, value);
+}
+
+template<typename T>
+inline void appendArg(std::string& buffer, const T* value) {
+    appendHex(buffer, reinterpret_cast<uintptr_t>(value));
+}
+
+/// 其他类型使用operator<<，较慢
+template<typename T>
+inline typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_pointer<T>::value>::type
+appendArg(std::string& buffer, const T& value) {
+    static thread_local std::ostringstream s_oss;
+    s_oss.str("");
+    s_oss << value;
+    buffer.append(s_oss.str());
+}
+
+//formatTo
+/*******************************************************************************/
+/// @brief appendLiteral 追加fmt中到下一个占位符为止的部分，处理"{{"和"}}"
+///
+/// @return 占位符之后的位置，没有占位符时返回nullptr
+inline const char* appendLiteral(std::string& buffer, const char* fmt) {
+    const char* begin = fmt;
+    for (; *fmt; ++fmt) {
+        if ((fmt[0] == '{' || fmt[0] == '}') && fmt[1] == fmt[0]) {
+            buffer.append(begin, fmt + 1 - begin);
+            begin = ++fmt + 1;
+        } else if (fmt[0] == '{' && fmt[1] == '}') {
+            buffer.append(begin, fmt - begin);
+            return fmt + 2;
+        }
+    }
+    buffer.append(begin, fmt - begin);
+    return nullptr;
+}
+
+inline void formatTo(std::string& buffer, const char* fmt) {
+    while (fmt) {
+        fmt = appendLiteral(buffer, fmt);
+        //多余的占位符原样输出
+        if (fmt) {
+            buffer.append("{}");
+        }
+    }
+}
+
+/// @brief formatTo 把"{}"风格的格式化结果追加到buffer，只遍历一次格式字符串
+///
+/// @param buffer 输出缓冲区
+/// @param fmt 格式字符串
+/// @param arg 第一个参数
+/// @param args 其余参数
+template<typename T, typename... Args>
+inline void formatTo(std::string& buffer, const char* fmt, const T& arg, const Args&... args) {
+    fmt = appendLiteral(buffer, fmt);
+    if (!fmt) {
+        return;
+    }
+    appendArg(buffer, arg);
+    formatTo(buffer, fmt, args...);
+}
+
+/// @brief printfTo 用printf风格格式化到buffer，覆盖buffer原有内容
+///
+/// 先利用buffer已有的容量，只有结果放不下时才扩容后再格式化一次
+template<typename... Args>
+inline void printfTo(std::string& buffer, const char* fmt, Args... args) {
+    if (buffer.capacity() < 128) {
+        buffer.reserve(128);
+    }
+    buffer.resize(buffer.capacity());
+    int len = snprintf(&buffer[0], buffer.size() + 1, fmt, args...);
+    if (len < 0) {
+        buffer.clear();
+        return;
+    }
+    if (size_t(len) > buffer.size()) {
+        buffer.resize(len);
+        snprintf(&buffer[0], buffer.size() + 1, fmt, args...);
+    }
+    buffer.resize(len);
+}
+
+//延迟格式化：生产者只把参数的二进制拷贝进日志事件，由AsLogger后台线程格式化
+/*******************************************************************************/
+/// @brief 把参数序列化后的字节格式化为字符串的函数，每种参数类型组合实例化一个
+using ArgsDecoder = void (*)(std::string& out, const char* fmt, const char* data);
+
+/// @brief appendBytes 追加长度和字节
+inline void appendBytes(std::string& buffer, const char* data, size_t size) {
+    uint32_t len = uint32_t(size);
+    buffer.append(reinterpret_cast<const char*>(&len), sizeof(len));
+    buffer.append(data, len);
+}
+
+/// @brief readBytes 读取appendBytes写入的字节
+inline const char* readBytes(const char* data, boost::string_view& value) {
+    uint32_t len;
+    memcpy(&len, data, sizeof(len));
+    value = boost::string_view(data + sizeof(len), len);
+    return data + sizeof(len) + len;
+}
+
+/// @brief 单个参数的序列化方式，默认在生产者线程格式化成字符串后保存
+template<typename T, typename Enable = void>
+struct ArgCodec {
+    static void encode(std::string& buffer, const T& value) {
+        std::string tmp;
+        appendArg(tmp, value);
+        appendBytes(buffer, tmp.data(), tmp.size());
+    }
+    static const char* decode(std::string& out, const char* data) {
+        boost::string_view value;
+        data = readBytes(data, value);
+        appendArg(out, value);
+        return data;
+    }
+};
+
+/// 算术类型按原始字节保存
+template<typename T>
+struct ArgCodec<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    static void encode(std::string& buffer, const T& value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    static const char* decode(std::string& out, const char* data) {
+        T value;
+        memcpy(&value, data, sizeof(T));
+        appendArg(out, value);
+        return data + sizeof(T);
+    }
+};
+
+/// 字符串拷贝内容
+template<>
+struct ArgCodec<const char*> {
+    static void encode(std::string& buffer, const char* value) {
+        if (!value) {
+            value = "(null)";
+        }
+        appendBytes(buffer, value, strlen(value));
+    }
+    static const char* decode(std::string& out, const char* data) {
+        boost::string_view value;
+        data = readBytes(data, value);
+        appendArg(out, value);
+        return data;
+    }
+};
+
+template<>
+struct ArgCodec<char*> : ArgCodec<const char*> {};
+
+template<size_t N>
+struct ArgCodec<char[N]> : ArgCodec<const char*> {
+    static void encode(std::string& buffer, const char (&value)[N]) {
+        appendBytes(buffer, value, strnlen(value, N));
+    }
+};
+
+template<>
+struct ArgCodec<std::string> : ArgCodec<const char*> {
+    static void encode(std::string& buffer, const std::string& value) {
+        appendBytes(buffer, value.data(), value.size());
+    }
+};
+
+template<>
+struct ArgCodec<boost::string_view> : ArgCodec<const char*> {
+    static void encode(std::string& buffer, boost::string_view value) {
+        appendBytes(buffer, value.data(), value.size());
+    }
+};
+
+/// 其他指针只保存地址
+template<typename T>
+struct ArgCodec<T*> {
+    static void encode(std::string& buffer, const T* value) {
+        uintptr_t addr = reinterpret_cast<uintptr_t>(value);
+        buffer.append(reinterpret_cast<const char*>(&addr), sizeof(addr));
+    }
+    static const char* decode(std::string& out, const char* data) {
+        uintptr_t addr;
+        memcpy(&addr, data, sizeof(addr));
+        appendHex(out, addr);
+        return data + sizeof(addr);
+    }
+};
+
+/// @brief 一组参数的序列化和格式化
+template<typename... Args>
+struct ArgsCodec;
+
+template<>
+struct ArgsCodec<> {
+    static void encode(std::string&) {}
+    static void decode(std::string& out, const char* fmt, const char*) {
+        formatTo(out, fmt);
+    }
+};
+
+template<typename T, typename... Rest>
+struct ArgsCodec<T, Rest...> {
+    static void encode(std::string& buffer, const T& arg, const Rest&... rest) {
+        ArgCodec<T>::encode(buffer, arg);
+        ArgsCodec<Rest...>::encode(buffer, rest...);
+    }
+    static void decode(std::string& out, const char* fmt, const char* data) {
+        fmt = appendLiteral(out, fmt);
+        if (!fmt) {
+            return;
+        }
+        data = ArgCodec<T>::decode(out, data);
+        ArgsCodec<Rest...>::decode(out, fmt, data);
+    }
+};
+
+}
+
+#endif /*__LOGFORMAT_HPP_*/
@@ -6,6 +6,9 @@
 #include <mutex>
 #include <map>
 #include <list>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
 
 #include <concurrentqueue/concurrentqueue.h>
 
@@ -13,6 +16,8 @@
 #include "logevent.hpp"
 #include "logconfig.hpp"
 #include "appender.hpp"
+#include "appenderlist.hpp"
+#include "logformat.hpp"
 
 namespace daq {
 
@@ -20,20 +25,82 @@ namespace daq {
 class Logger : public std::enable_shared_from_this<Logger> {
     public:
         using sptr = std::shared_ptr<Logger>;
+        /// @brief log 输出已经构造好的日志事件，不再检查日志级别
+        ///
+        /// @param event 日志事件
+        virtual void log(LogEvent::sptr event);
         virtual void log(LogLevel level, const std::string& msg);
         virtual void log(LogLevel level, const std::string& msg, const LocationInfo& location);
-        virtual void trace(const std::string& msg, const LocationInfo& location);
-        virtual void trace(const std::string& msg);
-        virtual void warn(const std::string& msg, const LocationInfo& location);
-        virtual void warn(const std::string& msg);
-        virtual void debug(const std::string& msg, const LocationInfo& location);
-        virtual void debug(const std::string& msg);
-        virtual void info(const std::string& msg, const LocationInfo& location);
-        virtual void info(const std::string& msg);
-        virtual void error(const std::string& msg, const LocationInfo& location);
-        virtual void error(const std::string& msg);
-        virtual void fatal(const std::string& msg, const LocationInfo& location);
-        virtual void fatal(const std::string& msg);
+
+        //按等级输出的快捷函数，不是虚函数，等级不够时在调用者内联的判断处直接返回
+#define XX(name, level) \
+        void name(const std::string& msg, const LocationInfo& location) { \
+            if (isEnabled(LogLevel::level)) { \
+                log(LogLevel::level, msg, location); \
+            } \
+        } \
+        void name(const std::string& msg) { \
+            if (isEnabled(LogLevel::level)) { \
+                log(LogLevel::level, msg); \
+            } \
+        }
+
+        XX(trace, TRACE)
+        XX(debug, DEBUG)
+        XX(info, INFO)
+        XX(warn, WARN)
+        XX(error, ERROR)
+        XX(fatal, FATAL)
+#undef XX
+
+        /**
+         * @brief logf 用"{}"风格格式化并输出日志，直接格式化到日志事件的缓冲区中
+         *
+         * 一般通过DAQ_LOGF等宏调用，宏会在编译期检查格式字符串
+         *
+         * @param level 日志等级
+         * @param location 位置信息
+         * @param fmt 格式
+         * @param args 参数
+         */
+        template<typename... Args>
+        void logf(LogLevel level, const LocationInfo& location, const char* fmt, const Args&... args) {
+            if (!isEnabled(level)) {
+                return;
+            }
+            LogEvent::sptr event(LogEvent::create(m_conf.loggerName, level, location));
+            //延迟格式化只用于调用点信息中带有同一个格式字符串的静态LocationInfo
+            if (m_deferredFormat.load(std::memory_order_relaxed)
+                    && location.isPersistent() && location.getFormat() == fmt) {
+                ArgsCodec<Args...>::encode(event->getArgsBuffer(), args...);
+                event->setArgsDecoder(&ArgsCodec<Args...>::decode);
+            } else {
+                formatTo(event->getContentBuffer(), fmt, args...);
+            }
+            log(std::move(event));
+        }
+
+        /**
+         * @brief logPrintf 用printf风格格式化并输出日志，直接格式化到日志事件的缓冲区中
+         *
+         * @param level 日志等级
+         * @param location 位置信息
+         * @param fmt 格式
+         * @param args 参数
+         */
+        template<typename... Args>
+        void logPrintf(LogLevel level, const LocationInfo& location, const char* fmt, Args... args) {
+            if (!isEnabled(level)) {
+                return;
+            }
+            LogEvent::sptr event(LogEvent::create(m_conf.loggerName, level, location));
+            printfTo(event->getContentBuffer(), fmt, args...);
+            log(std::move(event));
+        }
+        template<typename... Args>
+        void logPrintf(LogLevel level, const LocationInfo& location, const std::string& fmt, Args... args) {
+            logPrintf(level, location, fmt.c_str(), args...);
+        }
 
         /**
          * @brief addAppender 添加输出端
@@ -54,8 +121,19 @@ class Logger : public std::enable_shared_from_this<Logger> {
          *
          * @param level 日志等级
          */
-        virtual void setOutputLevel(LogLevel level) {
-            m_conf.outputLevel = level;
+        void setOutputLevel(LogLevel level) {
+            m_outputLevel.store(level, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief isEnabled 该等级的日志是否会输出，日志宏在求值参数之前调用
+         *
+         * @param level 日志等级
+         *
+         * @return 是否输出
+         */
+        bool isEnabled(LogLevel level) const {
+            return level >= m_outputLevel.load(std::memory_order_relaxed);
         }
 
         /**
@@ -63,8 +141,8 @@ class Logger : public std::enable_shared_from_this<Logger> {
          *
          * @return 日志等级
          */
-        virtual LogLevel getOutputLevel() const {
-            return m_conf.outputLevel;
+        LogLevel getOutputLevel() const {
+            return m_outputLevel.load(std::memory_order_relaxed);
         }
 
         /**
@@ -81,7 +159,7 @@ class Logger : public std::enable_shared_from_this<Logger> {
          *
          * @return 日志名称
          */
-        virtual const std::string getName() const {
+        virtual const std::string& getName() const {
             return m_conf.loggerName;
         }
 
@@ -132,6 +210,7 @@ class Logger : public std::enable_shared_from_this<Logger> {
          */
         virtual void setConfig(const log_config_t& conf) {
             m_conf = conf;
+            m_outputLevel.store(conf.outputLevel, std::memory_order_relaxed);
         }
 
         /**
@@ -140,16 +219,12 @@ class Logger : public std::enable_shared_from_this<Logger> {
          * @return std::list<std::string>
          */
         virtual std::list<std::string> getAllAppenderName() {
-            std::list<std::string> list;
-            for (auto e : m_appendersMap) {
-                list.push_back(e.first);
-            }
-            return list;
+            return m_appenders.getIds();
         }
 
     public:
         Logger(const std::string& name, const LogLevel level, size_t size = 256)
-            : m_conf(name, level, size) {
+            : m_conf(name, level, size), m_outputLevel(level) {
 
             if (m_conf.rawFormatter != "") {
                 m_formatter.reset(new Formatter(m_conf.rawFormatter));
@@ -171,10 +246,12 @@ class Logger : public std::enable_shared_from_this<Logger> {
 
     protected:
         log_config_t m_conf;
-        std::map<std::string, Appender*> m_appendersMap;
+        std::atomic<LogLevel> m_outputLevel;    ///当前输出等级，m_conf.outputLevel只是初始配置
+        AppenderList m_appenders;
         Formatter::sptr m_formatter;
         Formatter::sptr m_jsonFormatter;
         std::mutex m_mutex;
+        std::atomic<bool> m_deferredFormat{false};  ///logf是否只保存参数，由AsLogger后台线程格式化
 };
 
 //AsLogger
@@ -183,7 +260,10 @@ class AsLogger: public Logger {
         using sptr = std::shared_ptr<AsLogger>;
         AsLogger(const std::string& name = "root",
                  const LogLevel level = LogLevel::TRACE, size_t size = 256)
-            : Logger(name, level, size) {
+            : Logger(name, level, size),
+              m_buffer(size),
+              m_waitStrategy(m_conf.waitStrategy) {
+            m_deferredFormat.store(m_conf.deferredFormat);
 
             if (m_conf.rawFormatter != "") {
                 m_formatter.reset(new Formatter(m_conf.rawFormatter));
@@ -197,23 +277,85 @@ class AsLogger: public Logger {
                 m_jsonFormatter.reset(new Formatter("[{\"headers\":{\"app_id\":\"%N\"},\"body\":\"%d{%Y-%m-%d %H:%M:%S},%p,%f:%l,%C,%M,%t,%m\"}]"));
             }
 
-            m_buffer = moodycamel::ConcurrentQueue<LogEvent::sptr>(m_conf.asyncBufferSize);
-            pullEvent(m_buffer, m_appendersMap);
+            startWorker();
         }
 
-    public:
-        static void pullEvent(moodycamel::ConcurrentQueue<LogEvent::sptr>& buffer,
-                              std::map<std::string, Appender*>& appenders);
+        /// @brief 析构时先停止后台线程，并把队列中剩余的日志输出完
+        virtual ~AsLogger() {
+            stopWorker();
+        }
 
+    public:
         size_t getBufferSize() const {
             return m_conf.asyncBufferSize;
         }
 
+        /**
+         * @brief setWaitStrategy 设置后台线程在队列为空时的等待策略
+         *
+         * @param strategy 等待策略
+         */
+        void setWaitStrategy(WaitStrategy strategy) {
+            m_conf.waitStrategy = strategy;
+            m_waitStrategy.store(strategy, std::memory_order_relaxed);
+            notifyWorker();
+        }
+
+        /**
+         * @brief setDeferredFormat 设置延迟格式化模式
+         *
+         * 打开后DAQ_LOGF等宏在调用线程只拷贝调用点指针和参数的二进制，
+         * 字符串按内容拷贝，格式化由后台线程完成
+         *
+         * @param deferred 是否延迟格式化
+         */
+        void setDeferredFormat(bool deferred) {
+            m_conf.deferredFormat = deferred;
+            m_deferredFormat.store(deferred, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief getWaitStrategy 获取后台线程的等待策略
+         *
+         * @return 等待策略
+         */
+        WaitStrategy getWaitStrategy() const {
+            return m_waitStrategy.load(std::memory_order_relaxed);
+        }
+
+        using Logger::log;
+        virtual void log(LogEvent::sptr event) override;
         virtual void log(LogLevel level, const std::string& msg) override;
         virtual void log(LogLevel level, const std::string& msg, const LocationInfo& location) override;
 
     private:
+        /// @brief 启动后台线程
+        void startWorker();
+        /// @brief 停止后台线程，返回前会输出队列中剩余的日志
+        void stopWorker();
+        /// @brief 后台线程主循环，批量取出日志事件并交给appender
+        void pullEvent();
+        /// @brief 队列为空时按照等待策略等待
+        ///
+        /// @param idleRounds 连续空转的次数
+        void waitForEvent(size_t idleRounds);
+        /// @brief 生产者入队后调用，只有后台线程挂起时才加锁唤醒
+        void notifyWorker();
+        /// @brief 把一条日志事件放入队列
+        void pushEvent(LogEvent::sptr&& event);
+
+    private:
+        static constexpr size_t BATCH_SIZE = 64;     ///每次批量取出的最大日志数
+        static constexpr size_t SPIN_ROUNDS = 256;   ///自旋的次数
+        static constexpr size_t YIELD_ROUNDS = 64;   ///自旋之后yield的次数
+
         moodycamel::ConcurrentQueue<LogEvent::sptr> m_buffer;
+        std::atomic<WaitStrategy> m_waitStrategy;
+        std::atomic<bool> m_running{false};
+        std::atomic<bool> m_sleeping{false};
+        std::mutex m_sleepMutex;
+        std::condition_variable m_sleepCond;
+        std::thread m_worker;
 };
 
 }
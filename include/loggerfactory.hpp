@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <atomic>
 #include <boost/noncopyable.hpp>
 #include "logconfig.hpp"
 #include "logger.hpp"
@@ -33,17 +34,27 @@ class LoggerFactory: public boost::noncopyable {
         ///
         /// @param filename 文件名
         void initFromFile(const std::string& filename);
+        /// @brief getDefaultLogger 返回默认logger(名字最小的logger)，没有logger时创建"root"
+        ///
+        /// 无锁，只读一个原子指针;logger创建后不会销毁，指针一直有效
+        ///
+        /// @return Logger*
+        Logger* getDefaultLogger() {
+            Logger* logger = m_defaultLogger.load(std::memory_order_acquire);
+            return logger ? logger : initialize().get();
+        }
+        /// @brief getFirstLogger 返回默认logger的智能指针
+        ///
+        /// @return Logger::sptr
         Logger::sptr getFirstLogger() {
-            for (auto e : m_loggers) {
-                return e.second;
-            }
-            return m_loggers["root"];
+            return getDefaultLogger()->shared_from_this();
         }
 
     private:
         static LoggerFactory* m_factory;
         std::mutex m_mutex;
         std::map<std::string, Logger::sptr> m_loggers;
+        std::atomic<Logger*> m_defaultLogger{nullptr};
         LogConfigurator* m_logConfer;
 
     private:
@@ -77,107 +88,142 @@ class AsLoggerFactory : public boost::noncopyable {
         ///
         /// @param filename 文件名
         void initFromFile(const std::string& filename);
-
+        /// @brief getDefaultLogger 返回默认异步logger(名字最小的logger)，没有logger时创建"root"
+        ///
+        /// 无锁，只读一个原子指针;logger创建后不会销毁，指针一直有效
+        ///
+        /// @return AsLogger*
+        AsLogger* getDefaultLogger() {
+            AsLogger* logger = m_defaultLogger.load(std::memory_order_acquire);
+            return logger ? logger : initialize().get();
+        }
+        /// @brief getFirstLogger 返回默认异步logger的智能指针
+        ///
+        /// @return Logger::sptr
         Logger::sptr getFirstLogger() {
-            for (auto e : m_loggers) {
-                return e.second;
-            }
-            return m_loggers["root"];
+            return getDefaultLogger()->shared_from_this();
         }
     private:
         static AsLoggerFactory* m_factory;
         LogConfigurator* m_logConfer;
         std::mutex m_mutex;
         std::map<std::string, AsLogger::sptr> m_loggers;
+        std::atomic<AsLogger*> m_defaultLogger{nullptr};
     private:
         AsLoggerFactory();
         virtual ~AsLoggerFactory ();
 };
 
-//log宏，将log输出到控制台
+//logger句柄
 /*******************************************************************************/
-#define DAQ_LOG_TRACE(fmt, ...) {\
-	if ((fmt)) { \
-		char log_buffer_[sizeof(__VA_ARGS__)];\
-		sprintf(log_buffer_, fmt, __VA_ARGS__); \
-		LoggerFactory::instance()->getFirstLogger()->trace(log_buffer_,LOCATIONINFO);\
-	}\
-}
-
-#define DAQ_LOG_INFO(fmt, ...) {\
-	if ((fmt)) {\
-		char log_buffer_[sizeof(__VA_ARGS__)];\
-		sprintf(log_buffer_, fmt, __VA_ARGS__);\
-		LoggerFactory::instance()->getFirstLogger()->info(log_buffer_, LOCATIONINFO);\
-	}\
-}
-
-#define DAQ_LOG_DEBUG(fmt, ...) {\
-	if ((fmt)) { \
-		char log_buffer_[sizeof(__VA_ARGS__)];\
-		sprintf(log_buffer_, fmt, __VA_ARGS__); \
-		LoggerFactory::instance()->getFirstLogger()->debug(log_buffer_,LOCATIONINFO);\
-	}\
-}
-
-#define DAQ_LOG_ERROR(fmt, ...) {\
-	if ((fmt)) { \
-		char log_buffer_[sizeof(__VA_ARGS__)];\
-		sprintf(log_buffer_, fmt, __VA_ARGS__); \
-		LoggerFactory::instance()->getFirstLogger()->error(log_buffer_,LOCATIONINFO);\
-	}\
-}
-
-#define DAQ_LOG_FATAL(fmt, ...) {\
-	if ((fmt)) { \
-		char log_buffer_[sizeof(__VA_ARGS__)];\
-		sprintf(log_buffer_, fmt, __VA_ARGS__); \
-		LoggerFactory::instance()->getFirstLogger()->fatal(log_buffer_,LOCATIONINFO);\
-	}\
-}
-
-#define DAQ_ASLOG_TRACE(fmt, ...) {\
-	if ((fmt)) { \
-		char log_buffer_[sizeof(__VA_ARGS__)];\
-		sprintf(log_buffer_, fmt, __VA_ARGS__); \
-		AsLoggerFactory::instance()->getFirstLogger()->trace(log_buffer_,LOCATIONINFO);\
-	}\
-}
-
-#define DAQ_ASLOG_INFO(fmt, ...) {\
-	if ((fmt)) { \
-		char log_buffer_[sizeof(__VA_ARGS__)];\
-		sprintf(log_buffer_, fmt, __VA_ARGS__); \
-		AsLoggerFactory::instance()->getFirstLogger()->info(log_buffer_,LOCATIONINFO);\
-	}\
-}
-
-#define DAQ_ASLOG_DEBUG(fmt, ...) {\
-	if ((fmt)) { \
-		char log_buffer_[sizeof(__VA_ARGS__)];\
-		sprintf(log_buffer_, fmt, __VA_ARGS__); \
-		AsLoggerFactory::instance()->getFirstLogger()->debug(log_buffer_,LOCATIONINFO);\
-	}\
-}
-
-#define DAQ_ASLOG_ERROR(fmt, ...) {\
-	if ((fmt)) { \
-		char log_buffer_[sizeof(__VA_ARGS__)];\
-		sprintf(log_buffer_, fmt, __VA_ARGS__); \
-		AsLoggerFactory::instance()->getFirstLogger()->error(log_buffer_,LOCATIONINFO);\
-	}\
-}
-
-#define DAQ_ASLOG_FATAL(fmt, ...) {\
-	if ((fmt)) { \
-		char log_buffer_[sizeof(__VA_ARGS__)];\
-		sprintf(log_buffer_, fmt, __VA_ARGS__); \
-		AsLoggerFactory::instance()->getFirstLogger()->fatal(log_buffer_,LOCATIONINFO);\
-	}\
-}
+/// @brief DAQ_LOGGER 按名字取得同步logger，每个调用点只在第一次执行时查找(不存在时创建)，
+///        之后直接返回缓存的Logger*
+///
+/// 例如：DAQ_LOGF(DAQ_LOGGER("net"), LogLevel::INFO, "recv {} bytes", n);
+/// 名字必须是字符串字面量，传入变量时编译失败；运行时才知道的名字用LoggerFactory::initialize
+#define DAQ_LOGGER(name) ({ \
+    static ::daq::Logger* const daq_logger_handle_ = \
+        ::daq::LoggerFactory::instance()->initialize("" name "").get(); \
+    daq_logger_handle_; \
+})
+/// @brief DAQ_ASLOGGER 按名字取得异步logger，用法同DAQ_LOGGER
+#define DAQ_ASLOGGER(name) ({ \
+    static ::daq::AsLogger* const daq_logger_handle_ = \
+        ::daq::AsLoggerFactory::instance()->initialize("" name "").get(); \
+    daq_logger_handle_; \
+})
+
+//"{}"风格的日志宏，格式字符串必须是字符串字面量，在编译期检查占位符个数
+/*******************************************************************************/
+/// @brief DAQ_LOGF 用指定logger输出"{}"风格格式化的日志
+///
+/// 例如：DAQ_LOGF(logger, LogLevel::INFO, "event {} size {}", id, size);
+/// 占位符个数和参数个数不一致时编译失败，"{{"和"}}"输出花括号。
+/// 低于DAQ_LOG_ACTIVE_LEVEL的调用在编译期去掉；运行时等级不够时只有一次判断，
+/// 不会求值参数，也不会格式化
+#define DAQ_LOGF(logger, level, fmt, ...) do { \
+    static_assert(::daq::checkFormat(fmt, sizeof(::daq::formatArgCounter(__VA_ARGS__)) - 1), \
+                  "DAQ_LOGF: the number of {} in the format string does not match the arguments"); \
+    if (::daq::isLevelActive(level)) { \
+        auto&& daq_logger_ = (logger); \
+        if (daq_logger_->isEnabled(level)) { \
+            const ::daq::LocationInfo& daq_location_ = DAQ_LOCATION_SITE(level, fmt); \
+            daq_logger_->logf(level, daq_location_, daq_location_.getFormat(), ##__VA_ARGS__); \
+        } \
+    } \
+} while (0)
+
+/// @brief DAQ_LOGP 用指定logger输出printf风格格式化的日志，等级判断同DAQ_LOGF
+///
+/// 例如：DAQ_LOGP(logger, LogLevel::INFO, "event %d size %zu", id, size);
+#define DAQ_LOGP(logger, level, fmt, ...) do { \
+    if (::daq::isLevelActive(level)) { \
+        auto&& daq_logger_ = (logger); \
+        if (daq_logger_->isEnabled(level)) { \
+            daq_logger_->logPrintf(level, DAQ_LOCATION_SITE(level, nullptr), fmt, ##__VA_ARGS__); \
+        } \
+    } \
+} while (0)
+
+#define DLOGF_TRACE(fmt, ...) \
+    DAQ_LOGF(::daq::LoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::TRACE, fmt, ##__VA_ARGS__)
+#define DLOGF_DEBUG(fmt, ...) \
+    DAQ_LOGF(::daq::LoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::DEBUG, fmt, ##__VA_ARGS__)
+#define DLOGF_INFO(fmt, ...) \
+    DAQ_LOGF(::daq::LoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::INFO, fmt, ##__VA_ARGS__)
+#define DLOGF_WARN(fmt, ...) \
+    DAQ_LOGF(::daq::LoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::WARN, fmt, ##__VA_ARGS__)
+#define DLOGF_ERROR(fmt, ...) \
+    DAQ_LOGF(::daq::LoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::ERROR, fmt, ##__VA_ARGS__)
+#define DLOGF_FATAL(fmt, ...) \
+    DAQ_LOGF(::daq::LoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::FATAL, fmt, ##__VA_ARGS__)
+
+#define DASLOGF_TRACE(fmt, ...) \
+    DAQ_LOGF(::daq::AsLoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::TRACE, fmt, ##__VA_ARGS__)
+#define DASLOGF_DEBUG(fmt, ...) \
+    DAQ_LOGF(::daq::AsLoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::DEBUG, fmt, ##__VA_ARGS__)
+#define DASLOGF_INFO(fmt, ...) \
+    DAQ_LOGF(::daq::AsLoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::INFO, fmt, ##__VA_ARGS__)
+#define DASLOGF_WARN(fmt, ...) \
+    DAQ_LOGF(::daq::AsLoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::WARN, fmt, ##__VA_ARGS__)
+#define DASLOGF_ERROR(fmt, ...) \
+    DAQ_LOGF(::daq::AsLoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::ERROR, fmt, ##__VA_ARGS__)
+#define DASLOGF_FATAL(fmt, ...) \
+    DAQ_LOGF(::daq::AsLoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::FATAL, fmt, ##__VA_ARGS__)
+
+//printf风格的log宏
+/*******************************************************************************/
+//先判断等级再求值参数，低于DAQ_LOG_ACTIVE_LEVEL的调用在编译期去掉
+#define DAQ_LOG_TRACE(fmt, ...) \
+    DAQ_LOGP(::daq::LoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::TRACE, fmt, ##__VA_ARGS__)
+#define DAQ_LOG_DEBUG(fmt, ...) \
+    DAQ_LOGP(::daq::LoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::DEBUG, fmt, ##__VA_ARGS__)
+#define DAQ_LOG_INFO(fmt, ...) \
+    DAQ_LOGP(::daq::LoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::INFO, fmt, ##__VA_ARGS__)
+#define DAQ_LOG_WARN(fmt, ...) \
+    DAQ_LOGP(::daq::LoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::WARN, fmt, ##__VA_ARGS__)
+#define DAQ_LOG_ERROR(fmt, ...) \
+    DAQ_LOGP(::daq::LoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::ERROR, fmt, ##__VA_ARGS__)
+#define DAQ_LOG_FATAL(fmt, ...) \
+    DAQ_LOGP(::daq::LoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::FATAL, fmt, ##__VA_ARGS__)
+
+#define DAQ_ASLOG_TRACE(fmt, ...) \
+    DAQ_LOGP(::daq::AsLoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::TRACE, fmt, ##__VA_ARGS__)
+#define DAQ_ASLOG_DEBUG(fmt, ...) \
+    DAQ_LOGP(::daq::AsLoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::DEBUG, fmt, ##__VA_ARGS__)
+#define DAQ_ASLOG_INFO(fmt, ...) \
+    DAQ_LOGP(::daq::AsLoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::INFO, fmt, ##__VA_ARGS__)
+#define DAQ_ASLOG_WARN(fmt, ...) \
+    DAQ_LOGP(::daq::AsLoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::WARN, fmt, ##__VA_ARGS__)
+#define DAQ_ASLOG_ERROR(fmt, ...) \
+    DAQ_LOGP(::daq::AsLoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::ERROR, fmt, ##__VA_ARGS__)
+#define DAQ_ASLOG_FATAL(fmt, ...) \
+    DAQ_LOGP(::daq::AsLoggerFactory::instance()->getDefaultLogger(), ::daq::LogLevel::FATAL, fmt, ##__VA_ARGS__)
 /*******************************************************************************/
 
 //LoggerFactory
+//printf风格，直接格式化到日志事件的缓冲区中，缓冲区容量足够时只调用一次snprintf；
+//低于DAQ_LOG_ACTIVE_LEVEL的调用在编译期去掉，但参数在调用前已经求值，需要时用DAQ_LOG_*宏
 template<typename... Args>
 /**
  * @brief DLOG_TRACE 打印trace-log
@@ -187,19 +233,10 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DLOG_TRACE(const LocationInfo& locationInfo, const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return LoggerFactory::instance()->getFirstLogger()->trace(new_buffer.data(), locationInfo);
+    if (!isLevelActive(LogLevel::TRACE)) {
+        return;
     }
-
-    return LoggerFactory::instance()->getFirstLogger()->trace(old_buffer, locationInfo);
+    LoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::TRACE, locationInfo, fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -210,19 +247,11 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DLOG_TRACE(const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return LoggerFactory::instance()->getFirstLogger()->trace(new_buffer.data());
+    if (!isLevelActive(LogLevel::TRACE)) {
+        return;
     }
-
-    return LoggerFactory::instance()->getFirstLogger()->trace(old_buffer);
+    LoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::TRACE, LocationInfo::getLocationUnavailable(),
+            fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -234,19 +263,10 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DLOG_INFO(const LocationInfo& locationInfo, const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return LoggerFactory::instance()->getFirstLogger()->info(new_buffer.data(), locationInfo);
+    if (!isLevelActive(LogLevel::INFO)) {
+        return;
     }
-
-    return LoggerFactory::instance()->getFirstLogger()->info(old_buffer, locationInfo);
+    LoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::INFO, locationInfo, fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -257,19 +277,11 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DLOG_INFO(const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return LoggerFactory::instance()->getFirstLogger()->info(new_buffer.data());
+    if (!isLevelActive(LogLevel::INFO)) {
+        return;
     }
-
-    return LoggerFactory::instance()->getFirstLogger()->info(old_buffer);
+    LoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::INFO, LocationInfo::getLocationUnavailable(),
+            fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -281,19 +293,10 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DLOG_DEBUG(const LocationInfo& locationInfo, const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return LoggerFactory::instance()->getFirstLogger()->debug(new_buffer.data(), locationInfo);
+    if (!isLevelActive(LogLevel::DEBUG)) {
+        return;
     }
-
-    return LoggerFactory::instance()->getFirstLogger()->debug(old_buffer, locationInfo);
+    LoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::DEBUG, locationInfo, fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -304,19 +307,11 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DLOG_DEBUG(const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return LoggerFactory::instance()->getFirstLogger()->debug(new_buffer.data());
+    if (!isLevelActive(LogLevel::DEBUG)) {
+        return;
     }
-
-    return LoggerFactory::instance()->getFirstLogger()->debug(old_buffer);
+    LoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::DEBUG, LocationInfo::getLocationUnavailable(),
+            fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -328,19 +323,10 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DLOG_ERROR(const LocationInfo& locationInfo, const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return LoggerFactory::instance()->getFirstLogger()->error(new_buffer.data(), locationInfo);
+    if (!isLevelActive(LogLevel::ERROR)) {
+        return;
     }
-
-    return LoggerFactory::instance()->getFirstLogger()->error(old_buffer, locationInfo);
+    LoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::ERROR, locationInfo, fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -351,19 +337,11 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DLOG_ERROR(const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return LoggerFactory::instance()->getFirstLogger()->error(new_buffer.data());
+    if (!isLevelActive(LogLevel::ERROR)) {
+        return;
     }
-
-    return LoggerFactory::instance()->getFirstLogger()->error(old_buffer);
+    LoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::ERROR, LocationInfo::getLocationUnavailable(),
+            fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -375,19 +353,10 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DLOG_FATAL(const LocationInfo& locationInfo, const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return LoggerFactory::instance()->getFirstLogger()->fatal(new_buffer.data(), locationInfo);
+    if (!isLevelActive(LogLevel::FATAL)) {
+        return;
     }
-
-    return LoggerFactory::instance()->getFirstLogger()->fatal(old_buffer, locationInfo);
+    LoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::FATAL, locationInfo, fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -398,19 +367,11 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DLOG_FATAL(const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return LoggerFactory::instance()->getFirstLogger()->fatal(new_buffer.data());
+    if (!isLevelActive(LogLevel::FATAL)) {
+        return;
     }
-
-    return LoggerFactory::instance()->getFirstLogger()->fatal(old_buffer);
+    LoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::FATAL, LocationInfo::getLocationUnavailable(),
+            fmt.c_str(), args...);
 }
 
 //AsLoggerFactory
@@ -423,19 +384,10 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DASLOG_TRACE(const LocationInfo& locationInfo, const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return AsLoggerFactory::instance()->getFirstLogger()->trace(new_buffer.data(), locationInfo);
+    if (!isLevelActive(LogLevel::TRACE)) {
+        return;
     }
-
-    return AsLoggerFactory::instance()->getFirstLogger()->trace(old_buffer, locationInfo);
+    AsLoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::TRACE, locationInfo, fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -446,19 +398,11 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DASLOG_TRACE(const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return AsLoggerFactory::instance()->getFirstLogger()->trace(new_buffer.data());
+    if (!isLevelActive(LogLevel::TRACE)) {
+        return;
     }
-
-    return AsLoggerFactory::instance()->getFirstLogger()->trace(old_buffer);
+    AsLoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::TRACE, LocationInfo::getLocationUnavailable(),
+            fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -470,19 +414,10 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DASLOG_INFO(const LocationInfo& locationInfo, const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return AsLoggerFactory::instance()->getFirstLogger()->info(new_buffer.data(), locationInfo);
+    if (!isLevelActive(LogLevel::INFO)) {
+        return;
     }
-
-    return AsLoggerFactory::instance()->getFirstLogger()->info(old_buffer, locationInfo);
+    AsLoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::INFO, locationInfo, fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -493,19 +428,11 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DASLOG_INFO(const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return AsLoggerFactory::instance()->getFirstLogger()->info(new_buffer.data());
+    if (!isLevelActive(LogLevel::INFO)) {
+        return;
     }
-
-    return AsLoggerFactory::instance()->getFirstLogger()->info(old_buffer);
+    AsLoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::INFO, LocationInfo::getLocationUnavailable(),
+            fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -517,19 +444,10 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DASLOG_DEBUG(const LocationInfo& locationInfo, const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return AsLoggerFactory::instance()->getFirstLogger()->debug(new_buffer.data(), locationInfo);
+    if (!isLevelActive(LogLevel::DEBUG)) {
+        return;
     }
-
-    return AsLoggerFactory::instance()->getFirstLogger()->debug(old_buffer, locationInfo);
+    AsLoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::DEBUG, locationInfo, fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -540,19 +458,11 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DASLOG_DEBUG(const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return AsLoggerFactory::instance()->getFirstLogger()->debug(new_buffer.data());
+    if (!isLevelActive(LogLevel::DEBUG)) {
+        return;
     }
-
-    return AsLoggerFactory::instance()->getFirstLogger()->debug(old_buffer);
+    AsLoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::DEBUG, LocationInfo::getLocationUnavailable(),
+            fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -564,19 +474,10 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DASLOG_ERROR(const LocationInfo& locationInfo, const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return AsLoggerFactory::instance()->getFirstLogger()->error(new_buffer.data(), locationInfo);
+    if (!isLevelActive(LogLevel::ERROR)) {
+        return;
     }
-
-    return AsLoggerFactory::instance()->getFirstLogger()->error(old_buffer, locationInfo);
+    AsLoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::ERROR, locationInfo, fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -587,19 +488,11 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DASLOG_ERROR(const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return AsLoggerFactory::instance()->getFirstLogger()->error(new_buffer.data());
+    if (!isLevelActive(LogLevel::ERROR)) {
+        return;
     }
-
-    return AsLoggerFactory::instance()->getFirstLogger()->error(old_buffer);
+    AsLoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::ERROR, LocationInfo::getLocationUnavailable(),
+            fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -611,19 +504,10 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DASLOG_FATAL(const LocationInfo& locationInfo, const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return AsLoggerFactory::instance()->getFirstLogger()->fatal(new_buffer.data(), locationInfo);
+    if (!isLevelActive(LogLevel::FATAL)) {
+        return;
     }
-
-    return AsLoggerFactory::instance()->getFirstLogger()->fatal(old_buffer, locationInfo);
+    AsLoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::FATAL, locationInfo, fmt.c_str(), args...);
 }
 
 template<typename... Args>
@@ -634,19 +518,11 @@ template<typename... Args>
  * @param args 可变参数
  */
 inline void DASLOG_FATAL(const std::string& fmt, Args... args) {
-    constexpr size_t old_len = 128;
-    char old_buffer[old_len];
-    size_t new_len = snprintf(old_buffer, old_len, fmt.c_str(), args...);
-    // 算上终止符'\0'
-    new_len++;
-
-    if (new_len > old_len) {
-        std::vector<char> new_buffer(new_len);
-        snprintf(new_buffer.data(), new_len, fmt.c_str(), args...);
-        return AsLoggerFactory::instance()->getFirstLogger()->fatal(new_buffer.data());
+    if (!isLevelActive(LogLevel::FATAL)) {
+        return;
     }
-
-    return AsLoggerFactory::instance()->getFirstLogger()->fatal(old_buffer);
+    AsLoggerFactory::instance()->getDefaultLogger()->logPrintf(LogLevel::FATAL, LocationInfo::getLocationUnavailable(),
+            fmt.c_str(), args...);
 }
 
 }
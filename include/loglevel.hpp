@@ -15,6 +15,29 @@ enum class LogLevel {
     FATAL = 5,
 };
 
+//编译期日志等级阈值，低于该等级的日志宏被整个去掉(参数也不会求值)
+//编译时定义，例如 -DDAQ_LOG_ACTIVE_LEVEL=DAQ_LOG_LEVEL_INFO
+#define DAQ_LOG_LEVEL_TRACE 0
+#define DAQ_LOG_LEVEL_DEBUG 1
+#define DAQ_LOG_LEVEL_INFO 2
+#define DAQ_LOG_LEVEL_WARN 3
+#define DAQ_LOG_LEVEL_ERROR 4
+#define DAQ_LOG_LEVEL_FATAL 5
+#define DAQ_LOG_LEVEL_OFF 6
+
+#ifndef DAQ_LOG_ACTIVE_LEVEL
+#define DAQ_LOG_ACTIVE_LEVEL DAQ_LOG_LEVEL_TRACE
+#endif
+
+/// @brief isLevelActive 日志等级是否不低于编译期阈值DAQ_LOG_ACTIVE_LEVEL
+///
+/// @param level 日志等级
+///
+/// @return 等级为常量时在编译期求值
+constexpr bool isLevelActive(LogLevel level) {
+    return static_cast<int>(level) >= DAQ_LOG_ACTIVE_LEVEL;
+}
+
 /// @brief LoglevelToStr 将日志等级转化为string
 ///
 /// @param level 日志等级
@@ -40,6 +63,31 @@ static std::string LoglevelToStr(LogLevel level) {
     return "Unknow";
 }
 
+/// @brief LoglevelToCStr 将日志等级转化为字符串常量，不分配内存
+///
+/// @param level 日志等级
+///
+/// @return 日志等级字符串
+inline const char* LoglevelToCStr(LogLevel level) {
+    switch(level) {
+#define XX(name) \
+    case LogLevel::name: \
+        return #name; \
+        break;
+
+        XX(TRACE);
+        XX(DEBUG);
+        XX(INFO);
+        XX(WARN);
+        XX(ERROR);
+        XX(FATAL);
+#undef XX
+    default:
+        return "Unknow";
+    }
+    return "Unknow";
+}
+
 }
 
 #endif /*__LOGLEVEL_HPP_*/
@@ -0,0 +1,109 @@
+#ifndef __SEGMENTLIST_HPP_
+#define __SEGMENTLIST_HPP_
+
+#include <cstdint>
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <memory>
+
+namespace daq {
+
+/// @brief RollFileAppender按时间滚动的周期
+enum class RollPeriod {
+    NONE = 0,       ///只按大小滚动
+    HOURLY = 1,     ///每个整点
+    DAILY = 2,      ///每天0点
+};
+
+/// @brief 滚动文件的保留策略，0表示不限制，只统计已经关闭的文件
+struct RetentionPolicy {
+    size_t maxFiles = 0;        ///最多保留的文件数
+    uint64_t maxBytes = 0;      ///所有文件的总字节数上限
+    uint32_t maxAgeSec = 0;     ///文件关闭后最多保留的秒数
+};
+
+/**
+ * @brief RollFileAppender已经关闭的文件列表，按关闭顺序排列
+ *
+ * 只在创建时扫描一次目录，之后滚动和压缩完成时更新内存中的列表。
+ * 按时间保留时另外定时检查，长时间不滚动的文件也会按时删除。
+ * 超出保留策略的文件由LogCompressor的后台线程删除，不阻塞写日志的线程。
+ * 通过shared_ptr在后台任务中使用，Appender析构后仍然有效
+ */
+class SegmentList : public std::enable_shared_from_this<SegmentList> {
+    public:
+        using sptr = std::shared_ptr<SegmentList>;
+        ~SegmentList();
+
+        /**
+         * @brief scan 扫描目录中已有的文件(包括压缩后的文件)，加入列表
+         *
+         * @param dir 目录
+         * @param prefix 文件名前缀
+         * @param subfix 文件名后缀
+         */
+        void scan(const std::string& dir, const std::string& prefix, const std::string& subfix);
+
+        /**
+         * @brief add 加入一个刚关闭的文件
+         *
+         * @param path 文件名
+         * @param size 文件大小
+         * @param compressing 是否正在压缩，压缩完成前不会被删除
+         */
+        void add(const std::string& path, uint64_t size, bool compressing);
+
+        /**
+         * @brief replace 压缩完成后更新文件名和大小
+         *
+         * @param from 原文件名
+         * @param to 压缩后的文件名，压缩失败时和from相同
+         */
+        void replace(const std::string& from, const std::string& to);
+
+        /**
+         * @brief takeUncompressed 取出列表中还没有压缩的文件，标记为正在压缩
+         *
+         * 用于补压缩以前运行留下的文件(scan时已经存在的文件)
+         *
+         * @return 文件名
+         */
+        std::vector<std::string> takeUncompressed();
+
+        /// @brief setPolicy 设置保留策略，maxAgeSec不为0时由LogFlusher定时检查过期的文件
+        void setPolicy(const RetentionPolicy& policy);
+
+        /// @brief enforce 有文件超出保留策略时提交后台清理任务
+        void enforce();
+
+        /// @brief getTotalBytes 列表中所有文件的总字节数
+        uint64_t getTotalBytes();
+        /// @brief size 列表中的文件数
+        size_t size();
+
+    private:
+        struct Segment {
+            std::string path;
+            uint64_t size;
+            int64_t closeTime;      //关闭时间，秒
+            bool compressing;
+        };
+
+        /// @brief clean 从列表中取出超出保留策略的文件并删除，在后台线程中执行
+        void clean();
+        /// @brief exceeded 最旧的文件是否超出保留策略，调用时持有m_mutex
+        bool exceeded(int64_t now) const;
+
+    private:
+        std::mutex m_mutex;
+        std::deque<Segment> m_segments;
+        RetentionPolicy m_policy;
+        uint64_t m_totalBytes = 0;
+        bool m_cleaning = false;        //已经提交了清理任务
+};
+
+}
+
+#endif /* __SEGMENTLIST_HPP_ */
@@ -0,0 +1,136 @@
+#ifndef __SPOOL_HPP_
+#define __SPOOL_HPP_
+
+#include <cstdint>
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <chrono>
+
+#include <boost/noncopyable.hpp>
+
+namespace daq {
+
+/// @brief 网络Appender的本地缓存策略
+struct SpoolPolicy {
+    std::string dir;                            ///缓存目录，每个Appender一个，为空时不缓存
+    uint64_t segmentBytes = 16 * 1024 * 1024;   ///每个段文件的大小
+    uint64_t maxBytes = 1024 * 1024 * 1024;     ///所有段文件的总字节数上限，超出时删除最旧的段
+    uint64_t drainRate = 0;                     ///恢复后每秒最多取出的字节数，0表示不限制
+};
+
+/**
+ * @brief 远端不可用时暂存日志的磁盘队列
+ *
+ * 目录中是按序号命名的只追加段文件("序号.spool")，每条记录是
+ * 长度、crc32、标志加数据。读位置(段序号和偏移)写在"offset"文件中，
+ * 每取出一条记录更新一次，进程重启后从上次的位置继续。读完的段文件被删除。
+ * 写入直接进入页缓存，进程崩溃不丢失；末尾写了一半的记录在读取时被跳过。
+ * 线程安全
+ */
+class Spool : public boost::noncopyable {
+    public:
+        /**
+         * @brief open 打开(或创建)缓存目录，恢复上次的读位置
+         *
+         * @param policy 缓存策略
+         *
+         * @return 目录无法创建时返回nullptr
+         */
+        static std::unique_ptr<Spool> open(const SpoolPolicy& policy);
+        ~Spool();
+
+        /**
+         * @brief push 追加一条记录
+         *
+         * @param data 数据
+         * @param len 长度
+         * @param flags 调用者自己定义的标志，和数据一起取出
+         *
+         * @return 写入失败(例如磁盘满)时返回false
+         */
+        bool push(const char* data, size_t len, uint32_t flags = 0);
+
+        /**
+         * @brief front 读出最旧的一条记录，不移动读位置，重复调用返回同一条
+         *
+         * @param data 输出，数据
+         * @param flags 输出，push时的标志
+         *
+         * @return 没有记录时返回false
+         */
+        bool front(std::string& data, uint32_t& flags);
+        /**
+         * @brief peek 读出从最旧的一条开始、同一个段中连续的多条记录，不移动读位置
+         *
+         * 读出的记录的长度保留在窗口中，pop取走窗口开头的记录，
+         * 之后的peek可以跳过窗口中还没有取走的记录
+         *
+         * @param records 输出，记录的数据
+         * @param maxCount 最多读出的条数
+         * @param maxBytes 累计的数据不超过的字节数，第一条总是读出
+         * @param skip 跳过最旧的skip条，不能超过已经读出还没有取走的条数
+         * @param flags 输出，每条记录push时的标志，可以为nullptr
+         *
+         * @return 读出的条数，没有记录时为0
+         */
+        size_t peek(std::vector<std::string>& records, size_t maxCount, size_t maxBytes,
+                    size_t skip = 0, std::vector<uint32_t>* flags = nullptr);
+        /// @brief pop 取走front或peek读出的最旧的count条记录，保存读位置
+        void pop(size_t count = 1);
+
+        /// @brief empty 是否没有未取出的记录
+        bool empty();
+        /// @brief bytes 未取出的记录的总字节数
+        uint64_t bytes();
+        /// @brief lostSegments 超过maxBytes时删除了未读完的段的次数，变化时之前读出的记录已经不在缓存中
+        uint64_t lostSegments();
+        /// @brief delayMs 按drainRate限速，还需要等待多少毫秒才能取下一条
+        uint32_t delayMs();
+        const SpoolPolicy& getPolicy() const {
+            return m_policy;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        struct Segment {
+            uint64_t seq;
+            uint64_t size;
+        };
+
+        explicit Spool(const SpoolPolicy& policy);
+        bool init();
+        std::string segmentPath(uint64_t seq) const;
+        /// @brief loadHead 读出最旧的一条记录到m_head，调用时持有m_mutex
+        bool loadHead();
+        /// @brief roll 关闭当前的写段，打开下一个，调用时持有m_mutex
+        bool roll();
+        /// @brief dropFront 删除最旧的段，调用时持有m_mutex
+        void dropFront();
+        /// @brief saveOffset 保存读位置，调用时持有m_mutex
+        void saveOffset();
+
+    private:
+        SpoolPolicy m_policy;
+        std::mutex m_mutex;
+        std::deque<Segment> m_segments;     //按序号排列，m_writeFd打开时最后一个是写段
+        uint64_t m_totalBytes = 0;          //所有段的字节数，包括已经读过的部分
+        int m_writeFd = -1;
+        uint64_t m_lastSeq = 0;             //最大的段序号
+        int m_readFd = -1;                  //m_segments.front()的只读描述符
+        uint64_t m_readOffset = 0;          //m_segments.front()中的读位置
+        int m_offsetFd = -1;
+
+        std::string m_head;                 //front读出的记录
+        uint32_t m_headFlags = 0;
+        bool m_headValid = false;
+        std::vector<uint32_t> m_peekLens;   //从读位置开始已经读出的各条记录的长度，第一条是m_head
+        uint64_t m_lostSegments = 0;
+        Clock::time_point m_nextDrain;
+};
+
+}
+
+#endif /* __SPOOL_HPP_ */
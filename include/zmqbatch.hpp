@@ -0,0 +1,98 @@
+#ifndef __ZMQBATCH_HPP_
+#define __ZMQBATCH_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <functional>
+
+namespace daq {
+
+/// @brief ZMQAppender的发送策略
+struct ZmqSendPolicy {
+    size_t maxEvents = 1;           ///一个多帧消息最多的日志条数，每条日志一帧；1表示每条日志一个消息
+    size_t maxBytes = 64 * 1024;    ///一个消息的最大字节数
+    uint32_t maxAgeMs = 100;        ///maxEvents大于1时，日志最多等待的毫秒数
+    int sndhwm = 1000;              ///ZMQ_SNDHWM，内存中最多排队的消息数
+    int linger = 0;                 ///ZMQ_LINGER，关闭时等待未发送消息的毫秒数，-1表示一直等待
+    int sndtimeoMs = 1000;          ///ZMQ_SNDTIMEO，达到高水位时发送等待的毫秒数，超时的日志被丢弃，-1表示一直等待；
+                                    ///设置了缓存时不使用，固定为0，发送失败的日志写入缓存
+};
+
+/**
+ * @brief 把多条日志作为一个多帧消息发送，每条日志一帧
+ *
+ * 日志依次复制到缓冲池中的64KB缓冲块，多个消息共用一个缓冲块，写满后换下一个，
+ * 超过缓冲块大小的日志单独分配。发送时每帧用zmq_msg_init_data引用缓冲块中的数据，
+ * ZMQ不再复制。批次和交给ZMQ的每帧各持有缓冲块的一个引用，ZMQ的I/O线程发送完成后释放，
+ * 最后一个引用释放时缓冲块放回缓冲池，缓冲池在Appender析构后仍然有效。
+ * 不是线程安全的，由ZMQAppender加锁
+ */
+class ZmqBatch {
+    public:
+        ZmqBatch();
+        ~ZmqBatch();
+        ZmqBatch(const ZmqBatch&) = delete;
+        ZmqBatch& operator=(const ZmqBatch&) = delete;
+
+        /**
+         * @brief add 复制一条日志到缓冲块
+         *
+         * @param data 格式化后的日志
+         * @param len 长度
+         */
+        void add(const char* data, size_t len);
+        /// @brief count 已经加入的日志条数
+        size_t count() const {
+            return m_frames.size();
+        }
+        /// @brief bytes 已经加入的字节数
+        size_t bytes() const {
+            return m_bytes;
+        }
+        bool empty() const {
+            return m_frames.empty();
+        }
+
+        /**
+         * @brief send 每条日志一帧，作为一个多帧消息发送
+         *
+         * @param socket zsock_resolve得到的ZMQ套接字
+         *
+         * @return 成功时清空批次；失败时返回false，批次不变，可以用forEach取出全部日志，之后调用clear。
+         *         sent()不为0时套接字中留下了不完整的多帧消息，需要关闭套接字丢弃
+         */
+        bool send(void* socket);
+        /// @brief sent 上次send失败前已经交给ZMQ的帧数
+        size_t sent() const {
+            return m_sent;
+        }
+        /// @brief forEach 遍历批次中的日志
+        void forEach(const std::function<void(const char*, size_t)>& func) const;
+        /// @brief clear 丢弃批次中的日志
+        void clear();
+
+        /// 缓冲块和缓冲池在zmqbatch.cpp中定义
+        struct Chunk;
+        class ChunkPool;
+
+    private:
+        struct Frame {
+            Chunk* chunk;                   //批次持有一个引用，clear时释放
+            const char* data;
+            size_t len;
+        };
+
+    private:
+        std::shared_ptr<ChunkPool> m_pool;
+        Chunk* m_chunk = nullptr;           //正在写入的缓冲块，批次持有一个引用
+        size_t m_used = 0;                  //m_chunk中已经使用的字节数
+        std::vector<Frame> m_frames;
+        size_t m_bytes = 0;
+        size_t m_sent = 0;                  //send失败前已经交给ZMQ的帧数
+};
+
+}
+
+#endif /* __ZMQBATCH_HPP_ */
@@ -2,7 +2,13 @@
 #include <thread>
 #include <chrono>
 #include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <boost/filesystem.hpp>
 #include <json/json.h>
 #include "appender.hpp"
@@ -30,23 +36,55 @@ bool Appender::hasFormatter() {
 
 //StdoutAppender
 /*******************************************************************************/
-StdoutAppender::StdoutAppender() {
-    m_id += "::StdoutAppender";
+StdoutAppender::StdoutAppender(ConsoleStream stream)
+    : m_writer(ConsoleWriter::instance(int(stream))) {
+    m_id += stream == ConsoleStream::STDERR ? "::StdoutAppender" : "::StdoutAppender:stdout";
 }
 
 void StdoutAppender::append(LogEvent::sptr event) {
     std::lock_guard<std::mutex> lock_guard(m_appendMutex);
-    std::clog << m_formatter->format(event);
+    auto str = m_formatter->format(*event, m_formatBuffer);
+    m_writer->write(str.data(), str.size(), event->getLevel());
 }
 
 //Rolender
 /*******************************************************************************/
+/// 生成"目录/前缀 + 年月日时分秒-序号 + 后缀"形式的文件名，同一秒内序号递增，
+/// 并跳过已经存在的文件(包括压缩后的)，上次运行在同一秒内留下的文件不会被覆盖
+static std::string newSegmentName(const std::string& path, const std::string& prefix, const std::string& subfix,
+                                  std::string& lastStamp, uint32_t& sequence) {
+    time_t tt = time(0);
+    struct tm tm;
+    localtime_r(&tt, &tm);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y%m%d%H%M%S", &tm);
+    if (lastStamp == buffer) {
+        ++sequence;
+    } else {
+        lastStamp = buffer;
+        sequence = 0;
+    }
+    while (true) {
+        char number[16];
+        snprintf(number, sizeof(number), "-%03u", sequence);
+        std::string name = path + "/" + prefix + buffer + number + subfix;
+        if (access(name.c_str(), F_OK) != 0
+                && access((name + ".gz").c_str(), F_OK) != 0
+                && access((name + ".zst").c_str(), F_OK) != 0) {
+            return name;
+        }
+        ++sequence;
+    }
+}
+
 RollFileAppender::RollFileAppender(const std::string & path, u_int32_t size,
-                                   const std::string & prefix, const std::string & subfix)
+                                   const std::string & prefix, const std::string & subfix,
+                                   const FlushPolicy& policy)
     : m_path(path),
       m_maxFileSize(size),
       m_prefix(prefix),
-      m_subfix(subfix) {
+      m_subfix(subfix),
+      m_writer(policy) {
     std::stringstream ss;
     ss << "::FileRollAppender::" << prefix << "-" << subfix;
     m_id += ss.str();
@@ -57,56 +95,148 @@ RollFileAppender::RollFileAppender(const std::string & path, u_int32_t size,
     if(!boost::filesystem::is_directory(m_path)) {
         boost::filesystem::create_directories(m_path);
     }
+    //只在创建时扫描一次目录，之后在内存中维护文件列表
+    m_segments->scan(m_path, m_prefix, m_subfix);
     createNewFile();
     reopen();
+    setFlushPolicy(policy);
 }
 
 RollFileAppender::~RollFileAppender() {
-    closeFile();
+    LogFlusher::instance()->remove(this);
+    if (m_writer.isOpen()) {
+        uint64_t size = m_writer.size();
+        closeFile();
+        finishFile(m_currentFileName, size);
+    }
 }
 
 
 void RollFileAppender::createNewFile() {
+    m_currentFileName = newSegmentName(m_path, m_prefix, m_subfix, m_lastStamp, m_sequence);
+    updateNextRollTime();
+}
+
+void RollFileAppender::updateNextRollTime() {
+    if (m_period == RollPeriod::NONE) {
+        m_nextRollTime = UINT64_MAX;
+        return;
+    }
     time_t tt = time(0);
-    struct tm * time = localtime(&tt);
-    char buffer[128];
-    std::strftime(buffer, 128, "%Y%m%d%H%M%S", time);
-    m_currentFileName = m_path + "/" + m_prefix + buffer + m_subfix;
+    struct tm tm;
+    localtime_r(&tt, &tm);
+    tm.tm_sec = 0;
+    tm.tm_min = 0;
+    if (m_period == RollPeriod::HOURLY) {
+        tm.tm_hour += 1;
+    } else {
+        tm.tm_hour = 0;
+        tm.tm_mday += 1;
+    }
+    tm.tm_isdst = -1;
+    m_nextRollTime = uint64_t(mktime(&tm)) * 1000000000;
 }
 
 bool RollFileAppender::closeFile() {
-    if (m_fileStream.is_open()) {
-        m_fileStream.close();
-    }
-    return !m_fileStream.is_open();
+    m_writer.close();
+    return !m_writer.isOpen();
 }
 
 void RollFileAppender::append(LogEvent::sptr event) {
     std::lock_guard<std::mutex> lock_guard(m_appendMutex);
-    if (boost::filesystem::file_size(m_currentFileName) < m_maxFileSize * 1024 * 1024) {
-        m_fileStream << m_formatter->format(event);
-        m_fileStream.flush();
-    } else {
-        closeFile();
-        createNewFile();
-        reopen();
-        m_fileStream << m_formatter->format(event);
+    auto str = m_formatter->format(*event, m_formatBuffer);
+    //按内存中记录的大小滚动，文件不会超过上限(单条日志超过上限时除外)
+    if (event->getTimestamp() >= m_nextRollTime
+            || (m_writer.size() > 0 && m_writer.size() + str.size() > uint64_t(m_maxFileSize) * 1024 * 1024)) {
+        roll();
+    }
+    m_writer.write(str.data(), str.size(), event->getLevel());
+}
+
+void RollFileAppender::roll() {
+    closeFile();
+    std::string finished = m_currentFileName;
+    uint64_t size = m_writer.size();
+    createNewFile();
+    reopen();
+    finishFile(finished, size);
+}
+
+void RollFileAppender::finishFile(const std::string& path, uint64_t size) {
+    bool compressing = m_compression != Compression::NONE;
+    m_segments->add(path, size, compressing);
+    if (compressing) {
+        SegmentList::sptr segments = m_segments;
+        LogCompressor::instance()->submit(path, m_compression,
+        [segments](const std::string& from, const std::string& to) {
+            segments->replace(from, to);
+            segments->enforce();
+        });
+    }
+    m_segments->enforce();
+}
+
+void RollFileAppender::setCompression(Compression compression) {
+    std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+    m_compression = compression;
+    if (m_compression == Compression::NONE) {
+        return;
+    }
+    //上次运行最后写的文件在退出时没有压缩，或者压缩到一半时进程退出
+    SegmentList::sptr segments = m_segments;
+    for (const std::string& path : m_segments->takeUncompressed()) {
+        LogCompressor::instance()->submit(path, m_compression,
+        [segments](const std::string& from, const std::string& to) {
+            segments->replace(from, to);
+            segments->enforce();
+        });
     }
 }
 
+void RollFileAppender::rollOver() {
+    std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+    if (m_writer.isOpen()) {
+        roll();
+    }
+}
+
+void RollFileAppender::setRollPeriod(RollPeriod period) {
+    std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+    m_period = period;
+    updateNextRollTime();
+}
+
+void RollFileAppender::setRetention(const RetentionPolicy& policy) {
+    m_segments->setPolicy(policy);
+    m_segments->enforce();
+}
+
 bool RollFileAppender::reopen() {
-    if (m_fileStream.is_open())
-        m_fileStream.close();
-    m_fileStream.open(m_currentFileName);
+    uint64_t preallocate = m_writer.getPolicy().preallocate ? uint64_t(m_maxFileSize) * 1024 * 1024 : 0;
+    return m_writer.open(m_currentFileName, true, preallocate);
+}
+
+void RollFileAppender::setFlushPolicy(const FlushPolicy& policy) {
+    {
+        std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+        m_writer.setPolicy(policy);
+    }
+    LogFlusher::instance()->add(this, [this]() {
+        flush();
+    }, policy.intervalMs);
+}
 
-    return m_fileStream.is_open();
+void RollFileAppender::flush() {
+    std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+    m_writer.flush();
 }
 
 //SingleFileAppender不要多个Logger使用同一个文件
 /*******************************************************************************/
 SingleFileAppender::SingleFileAppender() {}
 
-SingleFileAppender::SingleFileAppender(const std::string & name): m_fileName(name) {
+SingleFileAppender::SingleFileAppender(const std::string & name, const FlushPolicy& policy)
+    : m_fileName(name), m_writer(policy) {
     std::stringstream ss;
     ss << "::FileAppender:" << m_fileName;
     m_id += ss.str();
@@ -118,126 +248,487 @@ SingleFileAppender::SingleFileAppender(const std::string & name): m_fileName(nam
     if (!reopen()) {
         std::cout << "SingleFileAppender open file error!"  << std::endl;
     }
+    setFlushPolicy(policy);
 }
 
 void SingleFileAppender::append(LogEvent::sptr event) {
     std::lock_guard<std::mutex> lock_guard(m_appendMutex);
-    m_fileStream << m_formatter->format(event);
-    m_fileStream.flush();
+    auto str = m_formatter->format(*event, m_formatBuffer);
+    m_writer.write(str.data(), str.size(), event->getLevel());
 }
 
 bool SingleFileAppender::reopen() {
-    if (m_fileStream.is_open())
-        m_fileStream.close();
-    m_fileStream.open(m_fileName, std::ios::out);
+    return m_writer.open(m_fileName);
+}
 
-    return m_fileStream.is_open();
+void SingleFileAppender::setFlushPolicy(const FlushPolicy& policy) {
+    {
+        std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+        m_writer.setPolicy(policy);
+    }
+    LogFlusher::instance()->add(this, [this]() {
+        flush();
+    }, policy.intervalMs);
+}
+
+void SingleFileAppender::flush() {
+    std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+    m_writer.flush();
 }
 
 SingleFileAppender::~SingleFileAppender() {
-    if(m_fileStream.is_open())
-        m_fileStream.close();
+    LogFlusher::instance()->remove(this);
+    m_writer.close();
 }
 
-//ZMQAppender
+//MmapFileAppender
 /*******************************************************************************/
-ZMQAppender::ZMQAppender(const std::string & endpoint)
-    : m_endpoint(endpoint) {
+//openSegment失败后的重试间隔，每次失败加倍
+static const uint32_t MMAP_OPEN_BACKOFF_MS = 100;
+static const uint32_t MMAP_OPEN_BACKOFF_MAX_MS = 10000;
+
+MmapFileAppender::MmapFileAppender(const std::string& path, u_int32_t size,
+                                   const std::string& prefix, const std::string& subfix,
+                                   uint32_t syncIntervalMs)
+    : m_path(path),
+      m_prefix(prefix),
+      m_subfix(subfix) {
     std::stringstream ss;
-    ss << "::ZMQAppender:" + m_endpoint;
+    ss << "::MmapFileAppender::" << prefix << "-" << subfix;
     m_id += ss.str();
-    m_push = zsock_new_push(m_endpoint.c_str());
+    size_t page = sysconf(_SC_PAGESIZE);
+    m_segmentSize = (uint64_t(size ? size : 64) * 1024 * 1024 + page - 1) / page * page;
+    if(!boost::filesystem::is_directory(m_path)) {
+        boost::filesystem::create_directories(m_path);
+    }
+    m_segments->scan(m_path, m_prefix, m_subfix);
+    reopenSegment();
+    LogFlusher::instance()->add(this, [this]() {
+        sync();
+    }, syncIntervalMs);
+}
+
+MmapFileAppender::~MmapFileAppender() {
+    LogFlusher::instance()->remove(this);
+    closeSegment();
+}
+
+bool MmapFileAppender::openSegment() {
+    m_currentFileName = newSegmentName(m_path, m_prefix, m_subfix, m_lastStamp, m_sequence);
+    m_fd = ::open(m_currentFileName.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        std::cout << "MmapFileAppender open " << m_currentFileName << " error: " << strerror(errno) << std::endl;
+        return false;
+    }
+    //预分配磁盘空间，写映射页时不会因为磁盘满收到SIGBUS；文件系统不支持时退回到稀疏文件
+    int err = posix_fallocate(m_fd, 0, m_segmentSize);
+    if (err != 0 && ftruncate(m_fd, m_segmentSize) != 0) {
+        err = errno;
+    } else {
+        err = 0;
+    }
+    void* base = MAP_FAILED;
+    if (err == 0) {
+        base = mmap(nullptr, m_segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        err = errno;
+    }
+    if (base == MAP_FAILED) {
+        std::cout << "MmapFileAppender map " << m_currentFileName << " error: " << strerror(err) << std::endl;
+        ::close(m_fd);
+        m_fd = -1;
+        unlink(m_currentFileName.c_str());
+        return false;
+    }
+    madvise(base, m_segmentSize, MADV_SEQUENTIAL);
+    m_base = static_cast<char*>(base);
+    m_used = 0;
+    m_synced = 0;
+    return true;
+}
+
+bool MmapFileAppender::reopenSegment() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now < m_nextOpen) {
+        return false;
+    }
+    if (!openSegment()) {
+        m_openBackoffMs = m_openBackoffMs ? std::min(m_openBackoffMs * 2, MMAP_OPEN_BACKOFF_MAX_MS)
+                          : MMAP_OPEN_BACKOFF_MS;
+        m_nextOpen = now + std::chrono::milliseconds(m_openBackoffMs);
+        return false;
+    }
+    m_openBackoffMs = 0;
+    if (m_dropped > m_reported) {
+        std::cout << "MmapFileAppender " << m_currentFileName << " recovered, dropped "
+                  << m_dropped - m_reported << " events" << std::endl;
+        m_reported = m_dropped;
+    }
+    return true;
+}
+
+void MmapFileAppender::drop() {
+    ++m_dropped;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - m_lastDropReport >= std::chrono::seconds(1)) {
+        std::cout << "MmapFileAppender " << m_path << " has no segment, dropped "
+                  << m_dropped - m_reported << " events" << std::endl;
+        m_reported = m_dropped;
+        m_lastDropReport = now;
+    }
+}
+
+void MmapFileAppender::closeSegment() {
+    if (m_fd < 0) {
+        return;
+    }
+    munmap(m_base, m_segmentSize);
+    m_base = nullptr;
+    //去掉预分配的尾部，正常关闭的分段和普通日志文件一样
+    if (ftruncate(m_fd, m_used) != 0) {
+        std::cout << "MmapFileAppender truncate " << m_currentFileName << " error: " << strerror(errno) << std::endl;
+    }
+    ::close(m_fd);
+    m_fd = -1;
+    m_segments->add(m_currentFileName, m_used, false);
+    m_segments->enforce();
+}
+
+void MmapFileAppender::append(LogEvent::sptr event) {
+    std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+    auto str = m_formatter->format(*event, m_formatBuffer);
+    const char* data = str.data();
+    size_t len = str.size();
+    //放不下时滚动，日志不跨分段；超过分段大小的日志才拆开写
+    if (m_used > 0 && m_used + len > m_segmentSize) {
+        closeSegment();
+    }
+    //打开分段失败(如磁盘满)后按退避时间重试，期间的日志丢弃并计数
+    if (m_base == nullptr && !reopenSegment()) {
+        drop();
+        return;
+    }
+    while (len > 0) {
+        size_t n = std::min(len, m_segmentSize - m_used);
+        memcpy(m_base + m_used, data, n);
+        m_used += n;
+        data += n;
+        len -= n;
+        if (len > 0) {
+            closeSegment();
+            if (!reopenSegment()) {
+                drop();
+                return;
+            }
+        }
+    }
+}
+
+void MmapFileAppender::sync() {
+    std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+    if (m_fd < 0 || m_used == m_synced) {
+        return;
+    }
+    //Linux上msync(MS_ASYNC)什么都不做，用sync_file_range只发起回写，不等待完成
+    sync_file_range(m_fd, m_synced, m_used - m_synced, SYNC_FILE_RANGE_WRITE);
+    m_synced = m_used;
+}
+
+void MmapFileAppender::rollOver() {
+    std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+    closeSegment();
+    reopenSegment();
+}
+
+void MmapFileAppender::setRetention(const RetentionPolicy& policy) {
+    m_segments->setPolicy(policy);
+    m_segments->enforce();
 }
 
-ZMQAppender::ZMQAppender(const std::string& host, const std::string& port)
+//ZMQAppender
+/*******************************************************************************/
+//缓存发送失败后后台线程等待的毫秒数，达到高水位时很快可以重试，连续失败时加倍
+static const uint32_t ZMQ_SPOOL_RETRY_MS = 1;
+static const uint32_t ZMQ_SPOOL_RETRY_MAX_MS = 100;
+
+ZMQAppender::ZMQAppender(const std::string & endpoint,
+                         const ZmqSendPolicy& policy, const SpoolPolicy& spool)
+    : m_endpoint(endpoint) {
+    init(policy, spool);
+}
+
+ZMQAppender::ZMQAppender(const std::string& host, const std::string& port,
+                         const ZmqSendPolicy& policy, const SpoolPolicy& spool)
     : m_host(host),
       m_port(port),
-      m_endpoint("tcp://" + host + ":" + port) {}
+      m_endpoint("tcp://" + host + ":" + port) {
+    init(policy, spool);
+}
 
-ZMQAppender::ZMQAppender(const std::string& host, size_t port)
+ZMQAppender::ZMQAppender(const std::string& host, size_t port,
+                         const ZmqSendPolicy& policy, const SpoolPolicy& spool)
     : m_host(host),
       m_port(std::to_string(port)),
-      m_endpoint("tcp://" + host + ":" + std::to_string(port)) {}
+      m_endpoint("tcp://" + host + ":" + std::to_string(port)) {
+    init(policy, spool);
+}
+
+void ZMQAppender::init(const ZmqSendPolicy& policy, const SpoolPolicy& spool) {
+    std::stringstream ss;
+    ss << "::ZMQAppender:" + m_endpoint;
+    m_id += ss.str();
+    m_policy = policy;
+    if (m_policy.maxEvents == 0) {
+        m_policy.maxEvents = 1;
+    }
+    if (!spool.dir.empty()) {
+        m_spool = Spool::open(spool);
+    }
+
+    connect();
+
+    if (m_spool) {
+        m_spooling = !m_spool->empty();
+        m_drainThread = std::thread(&ZMQAppender::drain, this);
+    }
+    LogFlusher::instance()->add(this, [this]() {
+        flush();
+    }, m_policy.maxEvents > 1 ? m_policy.maxAgeMs : 0);
+}
+
+void ZMQAppender::connect() {
+    //高水位等选项只对之后建立的连接有效，先设置再连接
+    m_push = zsock_new(ZMQ_PUSH);
+    if (m_push) {
+        zsock_set_sndhwm(m_push, m_policy.sndhwm);
+        zsock_set_linger(m_push, m_policy.linger);
+        //有缓存时发送不阻塞，不使用sndtimeoMs；没有建立连接时不在内存中排队，失败的日志写入缓存
+        zsock_set_immediate(m_push, m_spool ? 1 : 0);
+        zsock_set_sndtimeo(m_push, m_spool ? 0 : m_policy.sndtimeoMs);
+        if (zsock_attach(m_push, m_endpoint.c_str(), false) != 0) {
+            std::cout << "ZMQAppender " << m_endpoint << " attach failed" << std::endl;
+        }
+    }
+}
+
+bool ZMQAppender::sendBatch(ZmqBatch& batch) {
+    if (!m_push) {
+        return false;
+    }
+    if (batch.send(zsock_resolve(m_push))) {
+        return true;
+    }
+    if (batch.sent() > 0) {
+        //多帧消息发送到一半失败，关闭套接字丢弃不完整的消息，整个批次按失败处理
+        int err = zmq_errno();
+        zsock_destroy(&m_push);
+        connect();
+        errno = err;
+    }
+    return false;
+}
 
 void ZMQAppender::append(LogEvent::sptr event) {
     std::lock_guard<std::mutex> lock_guard(m_appendMutex);
-    auto str = m_formatter->format(event);
-    zstr_send(m_push, m_formatter->format(event).c_str());
+    auto out = m_formatter->format(*event, m_formatBuffer);
+    //缓存还没有发送完时排在后面，保持顺序
+    if (m_spooling) {
+        m_spool->push(out.data(), out.size());
+        return;
+    }
+    m_batch.add(out.data(), out.size());
+    if (m_batch.count() >= m_policy.maxEvents || m_batch.bytes() >= m_policy.maxBytes) {
+        send();
+    }
+}
+
+void ZMQAppender::send() {
+    if (sendBatch(m_batch)) {
+        return;
+    }
+    int err = zmq_errno();
+    if (m_spool) {
+        m_batch.forEach([this](const char* data, size_t len) {
+            m_spool->push(data, len);
+        });
+        if (!m_spooling) {
+            m_spooling = true;
+            std::lock_guard<std::mutex> lock_guard(m_drainMutex);
+            m_drainCond.notify_one();
+        }
+    } else {
+        m_batch.forEach([this](const char*, size_t) {
+            ++m_dropped;
+        });
+        //最多每秒打印一次，避免接收端不可用时刷屏
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - m_lastDropReport >= std::chrono::seconds(1)) {
+            std::cout << "ZMQAppender " << m_endpoint << " send failed: " << zmq_strerror(err)
+                      << ", dropped " << m_dropped - m_reported << " events" << std::endl;
+            m_reported = m_dropped;
+            m_lastDropReport = now;
+        }
+    }
+    m_batch.clear();
+}
+
+void ZMQAppender::flush() {
+    std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+    if (!m_batch.empty()) {
+        send();
+    }
+}
+
+size_t ZMQAppender::drainBatch(ZmqBatch& batch, std::vector<std::string>& records, bool locked) {
+    size_t count = m_spool->peek(records, m_policy.maxEvents, m_policy.maxBytes);
+    if (count == 0) {
+        return 0;
+    }
+    for (const std::string& record : records) {
+        batch.add(record.data(), record.size());
+    }
+    std::unique_lock<std::mutex> lock(m_appendMutex, std::defer_lock);
+    if (!locked) {
+        lock.lock();
+    }
+    bool ok = sendBatch(batch);
+    if (lock.owns_lock()) {
+        lock.unlock();
+    }
+    if (!ok) {
+        batch.clear();
+        return 0;
+    }
+    m_spool->pop(count);
+    return count;
+}
+
+void ZMQAppender::drain() {
+    //读缓存时不持有m_appendMutex，只在发送时短暂持有；余下的不超过一个批次时
+    //在锁内发送完，之后新的日志直接发送
+    ZmqBatch batch;
+    std::vector<std::string> records;
+    uint32_t retryMs = ZMQ_SPOOL_RETRY_MS;
+    std::unique_lock<std::mutex> lock(m_drainMutex);
+    while (!m_stop) {
+        if (m_spool->empty()) {
+            lock.unlock();
+            {
+                //写缓存失败时缓存仍然为空，也回到直接发送
+                std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+                m_spooling = !m_spool->empty();
+            }
+            lock.lock();
+            if (!m_stop && m_spool->empty()) {
+                m_drainCond.wait(lock);
+            }
+            continue;
+        }
+        uint32_t delay = m_spool->delayMs();
+        if (delay > 0) {
+            m_drainCond.wait_for(lock, std::chrono::milliseconds(delay));
+            continue;
+        }
+        lock.unlock();
+        size_t sent = drainBatch(batch, records, false);
+        if (sent > 0 && m_spool->bytes() <= m_policy.maxBytes) {
+            std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+            while (drainBatch(batch, records, true) > 0) {}
+            m_spooling = !m_spool->empty();
+        }
+        lock.lock();
+        //接收端不可用或者达到高水位
+        if (sent > 0) {
+            retryMs = ZMQ_SPOOL_RETRY_MS;
+        } else if (!m_stop) {
+            m_drainCond.wait_for(lock, std::chrono::milliseconds(retryMs));
+            retryMs = std::min(retryMs * 2, ZMQ_SPOOL_RETRY_MAX_MS);
+        }
+    }
 }
 
 ZMQAppender::~ZMQAppender() {
+    LogFlusher::instance()->remove(this);
+    if (m_drainThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock_guard(m_drainMutex);
+            m_stop = true;
+        }
+        m_drainCond.notify_one();
+        m_drainThread.join();
+    }
+    flush();
     zsock_destroy(&m_push);
 }
 
 //HTTP发送JSON
 /*******************************************************************************/
-HTTPAppender::HTTPAppender(const std::string& host, const std::string& port)
+HTTPAppender::HTTPAppender(const std::string& host, const std::string& port,
+                           const HttpBatchPolicy& policy, const HttpSendPolicy& sendPolicy,
+                           const SpoolPolicy& spool)
     : m_host(host), m_port(std::stol(port)), m_url("http://" + host + ":" + port) {
-    if (init() == -1) {
-        return;
-    }
+    init(sendPolicy, spool);
+    setBatchPolicy(policy);
 }
 
-HTTPAppender::HTTPAppender(const std::string& host, size_t port)
+HTTPAppender::HTTPAppender(const std::string& host, size_t port,
+                           const HttpBatchPolicy& policy, const HttpSendPolicy& sendPolicy,
+                           const SpoolPolicy& spool)
     : m_host(host), m_port(port), m_url("http://" + host + ":" + std::to_string(port)) {
-    if (init() == -1) {
-        return;
-    }
+    init(sendPolicy, spool);
+    setBatchPolicy(policy);
 }
 
 void HTTPAppender::append(LogEvent::sptr event) {
-    if (NULL == pCurl) {
-        std::cout << __FILE__ << ":" << __LINE__ << " CURLE_FAILED_INIT" << std::endl;
-        return ;
-    }
-
-    auto jsonOut = m_formatter->format(event);
-    //std::cout << jsonOut << std::endl;
-    // 设置要POST的JSON数据
-    curl_easy_setopt(pCurl, CURLOPT_POSTFIELDS, jsonOut.c_str());
-    curl_easy_setopt(pCurl, CURLOPT_POSTFIELDSIZE, jsonOut.size());//设置上传json串长度,这个设置可以忽略
-    char errbuf[128];
-    curl_easy_setopt(pCurl, CURLOPT_ERRORBUFFER, errbuf);
-    CURLcode res = curl_easy_perform(pCurl);
-    if(res != CURLE_OK) {
-        size_t len = strlen(errbuf);
-        fprintf(stderr, "\nlibcurl: (%d) ", res);
-        if(len)
-            fprintf(stderr, "%s%s", errbuf,
-                    ((errbuf[len - 1] != '\n') ? "\n" : ""));
-        else
-            fprintf(stderr, "%s\n", curl_easy_strerror(res));
-    }
-}
-
-int HTTPAppender::init() {
-    std::stringstream ss;
-    ss << "::HTTPAppender:" << m_host << ":" << m_port;
-    m_id += ss.str();
-
+    std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+    auto jsonOut = m_formatter->format(*event, m_formatBuffer);
+    m_batch.add(jsonOut.data(), jsonOut.size());
+    if (m_batch.count() >= m_policy.maxEvents || m_batch.bytes() >= m_policy.maxBytes) {
+        send();
+    }
+}
 
-    pCurl = curl_easy_init();
-    if (NULL == pCurl)
+void HTTPAppender::setBatchPolicy(const HttpBatchPolicy& policy) {
     {
-        std::cout << __FILE__ << ":" << __LINE__ << " CURLE_FAILED_INIT" << std::endl;
-        return -1;
+        std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+        m_policy = policy;
+        if (m_policy.maxEvents == 0) {
+            m_policy.maxEvents = 1;
+        }
     }
+    LogFlusher::instance()->add(this, [this]() {
+        flush();
+    }, policy.maxAgeMs);
+}
 
-    //设置http发送的内容类型为JSON
-    //构建HTTP报文头
-    headerlist = curl_slist_append(headerlist, "Content-Type:application/json;charset=UTF-8");
+void HTTPAppender::flush() {
+    {
+        std::lock_guard<std::mutex> lock_guard(m_appendMutex);
+        if (!m_batch.empty()) {
+            send();
+        }
+    }
+    //进程退出时I/O线程会被终止，等待积压的请求发送完
+    if (LogFlusher::instance()->isExiting()) {
+        m_sender->waitIdle(m_sender->getPolicy().timeoutMs);
+    }
+}
 
-    curl_easy_setopt(pCurl, CURLOPT_URL, m_url.c_str());
-    curl_easy_setopt(pCurl, CURLOPT_POST, 1);//设置为非0表示本次操作为POST
-    curl_easy_setopt(pCurl, CURLOPT_HTTPHEADER, headerlist);
+void HTTPAppender::send() {
+    m_sender->post(m_batch.take(), m_policy.gzip);
+}
 
-    return 0;
+void HTTPAppender::init(const HttpSendPolicy& sendPolicy, const SpoolPolicy& spool) {
+    std::stringstream ss;
+    ss << "::HTTPAppender:" << m_host << ":" << m_port;
+    m_id += ss.str();
+    m_sender.reset(new HttpSender(m_url, sendPolicy, spool));
 }
 
 HTTPAppender::~HTTPAppender() {
-    if (pCurl) {
-        curl_easy_cleanup(pCurl);
-    }
+    LogFlusher::instance()->remove(this);
+    flush();
+    //HttpSender析构时等待积压的请求发送完
+    m_sender.reset();
 }
 
 }
@@ -0,0 +1,110 @@
+#include <thread>
+#include <algorithm>
+
+#include "appenderlist.hpp"
+
+namespace daq {
+
+constexpr size_t AppenderList::SLOTS;
+
+AppenderList::AppenderList() : m_snapshot(new Snapshot) {
+    for (auto& slot : m_readers) {
+        slot.count[0].store(0, std::memory_order_relaxed);
+        slot.count[1].store(0, std::memory_order_relaxed);
+    }
+}
+
+AppenderList::~AppenderList() {
+    delete m_snapshot.load();
+}
+
+size_t AppenderList::threadSlot() {
+    static std::atomic<size_t> next{0};
+    static thread_local size_t slot = next.fetch_add(1, std::memory_order_relaxed) % SLOTS;
+    return slot;
+}
+
+//读者先在当前阶段的计数上加一，再读取快照指针(均为seq_cst)；
+//写者先替换快照指针，再检查计数。写者看到计数为0时，之后加计数的读者一定读到新快照
+AppenderList::ReadGuard::ReadGuard(const AppenderList& list) {
+    unsigned phase = list.m_phase.load(std::memory_order_relaxed) & 1;
+    m_count = &list.m_readers[threadSlot()].count[phase];
+    m_count->fetch_add(1, std::memory_order_seq_cst);
+}
+
+AppenderList::ReadGuard::~ReadGuard() {
+    m_count->fetch_sub(1, std::memory_order_release);
+}
+
+void AppenderList::waitReaders(unsigned phase) {
+    for (auto& slot : m_readers) {
+        size_t rounds = 0;
+        while (slot.count[phase].load(std::memory_order_acquire) != 0) {
+            if (++rounds > 64) {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+//两次切换阶段并分别等待，读到旧阶段号后停顿的读者也会在下一次切换后被等待到；
+//新读者总是进入新阶段，写者不会被持续的读者饿死
+void AppenderList::synchronize() {
+    unsigned phase = m_phase.load(std::memory_order_relaxed);
+    m_phase.store(phase + 1, std::memory_order_seq_cst);
+    waitReaders(phase & 1);
+    m_phase.store(phase + 2, std::memory_order_seq_cst);
+    waitReaders((phase + 1) & 1);
+}
+
+void AppenderList::publish(Snapshot* snapshot) {
+    Snapshot* old = m_snapshot.exchange(snapshot, std::memory_order_seq_cst);
+    synchronize();
+    delete old;
+}
+
+bool AppenderList::add(const std::string& id, Appender* appender) {
+    std::lock_guard<std::mutex> lock_guard(m_writeMutex);
+    const Snapshot* current = m_snapshot.load();
+    if (std::find(current->ids.begin(), current->ids.end(), id) != current->ids.end()) {
+        return false;
+    }
+    Snapshot* snapshot = new Snapshot(*current);
+    snapshot->appenders.push_back(appender);
+    snapshot->ids.push_back(id);
+    publish(snapshot);
+    return true;
+}
+
+Appender* AppenderList::remove(const std::string& id) {
+    std::lock_guard<std::mutex> lock_guard(m_writeMutex);
+    const Snapshot* current = m_snapshot.load();
+    auto it = std::find(current->ids.begin(), current->ids.end(), id);
+    if (it == current->ids.end()) {
+        return nullptr;
+    }
+    size_t index = it - current->ids.begin();
+    Appender* appender = current->appenders[index];
+    Snapshot* snapshot = new Snapshot(*current);
+    snapshot->appenders.erase(snapshot->appenders.begin() + index);
+    snapshot->ids.erase(snapshot->ids.begin() + index);
+    publish(snapshot);
+    return appender;
+}
+
+std::vector<Appender*> AppenderList::clear() {
+    std::lock_guard<std::mutex> lock_guard(m_writeMutex);
+    std::vector<Appender*> appenders = m_snapshot.load()->appenders;
+    if (!appenders.empty()) {
+        publish(new Snapshot);
+    }
+    return appenders;
+}
+
+std::list<std::string> AppenderList::getIds() const {
+    ReadGuard guard(*this);
+    const Snapshot* current = m_snapshot.load(std::memory_order_seq_cst);
+    return std::list<std::string>(current->ids.begin(), current->ids.end());
+}
+
+}
@@ -0,0 +1,528 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "filewriter.hpp"
+
+namespace daq {
+
+//FileWriter
+/*******************************************************************************/
+constexpr size_t FileWriter::ALIGNMENT;
+
+FileWriter::FileWriter(const FlushPolicy& policy) : m_policy(policy) {
+    allocBuffer();
+}
+
+FileWriter::~FileWriter() {
+    close();
+    freeBuffer();
+}
+
+void FileWriter::allocBuffer() {
+    if (m_policy.bufferSize < ALIGNMENT) {
+        m_policy.bufferSize = ALIGNMENT;
+    }
+    m_policy.bufferSize = (m_policy.bufferSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    size_t count = m_policy.asyncDepth ? m_policy.asyncDepth + 1 : 1;
+    for (size_t i = 0; i < count; ++i) {
+        void* buffer = nullptr;
+        if (posix_memalign(&buffer, ALIGNMENT, m_policy.bufferSize) != 0) {
+            freeBuffer();
+            throw std::bad_alloc();
+        }
+        m_buffers.push_back(static_cast<char*>(buffer));
+    }
+    m_current = 0;
+    m_buffer = m_buffers[0];
+    if (m_policy.asyncDepth) {
+        m_engine = IoEngine::create(m_buffers, m_policy.bufferSize);
+        m_pending.resize(count);
+        for (size_t i = count - 1; i > 0; --i) {
+            m_free.push_back(i);
+        }
+    }
+}
+
+void FileWriter::freeBuffer() {
+    drain();
+    m_engine.reset();
+    for (char* buffer : m_buffers) {
+        free(buffer);
+    }
+    m_buffers.clear();
+    m_pending.clear();
+    m_free.clear();
+    m_buffer = nullptr;
+}
+
+void FileWriter::setPolicy(const FlushPolicy& policy) {
+    if (policy.bufferSize != m_policy.bufferSize || policy.asyncDepth != m_policy.asyncDepth
+            || policy.directIo != m_policy.directIo) {
+        //写入方式变化时按新的方式重新打开，追加到文件末尾
+        int fd = m_fd;
+        bool owned = m_owned;
+        std::string path = m_path;
+        close();
+        freeBuffer();
+        m_policy = policy;
+        allocBuffer();
+        if (fd >= 0) {
+            if (owned) {
+                open(path, false);
+            } else {
+                attach(fd, path);
+            }
+        }
+    } else {
+        m_policy = policy;
+    }
+}
+
+bool FileWriter::open(const std::string& path, bool truncate, uint64_t preallocate) {
+    close();
+    //异步写和O_DIRECT的文件都写到指定偏移，不能用O_APPEND(Linux上pwrite会忽略偏移)
+    bool positioned = m_engine || m_policy.directIo;
+    int flags = O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : (positioned ? 0 : O_APPEND));
+    m_direct = false;
+    if (m_policy.directIo) {
+        //追加时要读回最后一个不完整的块，所以需要读权限
+        m_fd = ::open(path.c_str(), flags | O_RDWR | O_DIRECT, 0644);
+        m_direct = m_fd >= 0;
+        if (m_fd < 0 && errno == EINVAL) {
+            std::cout << "FileWriter " << path << " does not support O_DIRECT, use page cache" << std::endl;
+        }
+    }
+    if (m_fd < 0) {
+        m_fd = ::open(path.c_str(), flags | O_WRONLY, 0644);
+    }
+    if (m_fd < 0) {
+        std::cout << "FileWriter open " << path << " error: " << strerror(errno) << std::endl;
+        return false;
+    }
+    m_path = path;
+    m_fileSize = 0;
+    m_used = 0;
+    m_flushed = 0;
+    if (!truncate) {
+        struct stat st;
+        if (fstat(m_fd, &st) == 0) {
+            m_fileSize = st.st_size;
+        }
+        if (m_direct) {
+            //缓冲区从块边界开始，先读回最后一个不完整的块
+            size_t tail = m_fileSize % ALIGNMENT;
+            m_fileSize -= tail;
+            if (tail > 0 && ::pread(m_fd, m_buffer, ALIGNMENT, m_fileSize) >= ssize_t(tail)) {
+                m_used = m_flushed = tail;
+            } else {
+                m_fileSize += tail;
+            }
+        } else if (positioned) {
+            lseek(m_fd, m_fileSize, SEEK_SET);
+        }
+    }
+    //按文件大小一次分配磁盘空间，避免逐个extent增长产生碎片；不支持时(如tmpfs)忽略
+    //KEEP_SIZE不改变文件长度，读日志的程序和崩溃后的文件都看不到预分配的部分
+    if (preallocate > m_fileSize + m_used) {
+        fallocate(m_fd, FALLOC_FL_KEEP_SIZE, 0, preallocate);
+    }
+    return true;
+}
+
+void FileWriter::attach(int fd, const std::string& name) {
+    close();
+    m_fd = fd;
+    m_owned = false;
+    m_path = name;
+    m_fileSize = 0;
+    m_used = 0;
+    m_flushed = 0;
+    m_direct = false;
+}
+
+void FileWriter::close() {
+    if (m_fd < 0) {
+        return;
+    }
+    drain();
+    if (m_direct) {
+        truncateTail();
+    }
+    m_fileSize += m_used;
+    m_used = 0;
+    m_flushed = 0;
+    if (m_owned) {
+        ::close(m_fd);
+    }
+    m_fd = -1;
+    m_owned = true;
+}
+
+void FileWriter::write(const char* data, size_t len) {
+    //异步和O_DIRECT都只写出整个缓冲区，数据全部经过缓冲区
+    if (m_engine || m_direct) {
+        while (len > 0) {
+            size_t n = std::min(len, m_policy.bufferSize - m_used);
+            memcpy(m_buffer + m_used, data, n);
+            m_used += n;
+            data += n;
+            len -= n;
+            if (m_used == m_policy.bufferSize) {
+                if (m_engine) {
+                    submit();
+                } else {
+                    writeDirect();
+                }
+            }
+        }
+        return;
+    }
+    if (len <= m_policy.bufferSize - m_used) {
+        memcpy(m_buffer + m_used, data, len);
+        m_used += len;
+        return;
+    }
+    if (len < m_policy.bufferSize) {
+        flush();
+        memcpy(m_buffer, data, len);
+        m_used = len;
+        return;
+    }
+    //大块数据不经过缓冲区，和缓冲区中的数据一次writev写出
+    struct iovec iov[2];
+    iov[0].iov_base = m_buffer;
+    iov[0].iov_len = m_used;
+    iov[1].iov_base = const_cast<char*>(data);
+    iov[1].iov_len = len;
+    writeAll(iov, 2);
+}
+
+void FileWriter::flush() {
+    if (m_direct) {
+        //最后一个不完整的块下次还要重写，先等待之前的异步写完成，避免同一块的两次写乱序
+        waitInflight();
+        writeDirect();
+        //进程退出时appender不一定会析构，不会调用close，在这里去掉补齐的0；
+        //平时不截断，截断会释放preallocate预分配的磁盘空间
+        if (m_used > 0 && LogFlusher::instance()->isExiting()) {
+            truncateTail();
+        }
+        return;
+    }
+    if (m_engine) {
+        submit();
+        //进程退出时写线程池会被终止，需要等待写完成
+        if (LogFlusher::instance()->isExiting()) {
+            drain();
+        }
+        return;
+    }
+    if (m_used == 0) {
+        return;
+    }
+    struct iovec iov;
+    iov.iov_base = m_buffer;
+    iov.iov_len = m_used;
+    writeAll(&iov, 1);
+}
+
+void FileWriter::drain() {
+    if (m_engine && !m_direct) {
+        submit();
+    } else {
+        flush();
+    }
+    waitInflight();
+}
+
+void FileWriter::waitInflight() {
+    while (m_inflight > 0) {
+        reap(true);
+    }
+}
+
+void FileWriter::writeDirect() {
+    if (m_used == m_flushed) {
+        return;
+    }
+    if (m_fd < 0) {
+        m_used = m_flushed = 0;
+        return;
+    }
+    //O_DIRECT要求长度和偏移按块对齐，最后一块补0写出，缓冲区保留这一块，之后补齐时重写
+    size_t len = (m_used + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    memset(m_buffer + m_used, 0, len - m_used);
+    ssize_t n = pwriteAll(m_fd, m_buffer, len, m_fileSize);
+    if (n < 0) {
+        std::cout << "FileWriter write " << m_path << " error: " << strerror(-n) << std::endl;
+    }
+    size_t whole = m_used / ALIGNMENT * ALIGNMENT;
+    memmove(m_buffer, m_buffer + whole, m_used - whole);
+    m_fileSize += whole;
+    m_used -= whole;
+    m_flushed = m_used;
+}
+
+void FileWriter::truncateTail() {
+    //去掉O_DIRECT补齐的最后一块
+    if (ftruncate(m_fd, size()) != 0) {
+        std::cout << "FileWriter truncate " << m_path << " error: " << strerror(errno) << std::endl;
+    }
+}
+
+void FileWriter::submit() {
+    if (m_used == 0) {
+        return;
+    }
+    if (m_fd < 0) {
+        m_used = 0;
+        return;
+    }
+    m_pending[m_current] = Pending{m_fileSize, m_used};
+    m_engine->submit(m_fd, m_current, m_used, m_fileSize);
+    m_fileSize += m_used;
+    m_used = 0;
+    m_flushed = 0;
+    ++m_inflight;
+    reap(m_free.empty());
+    m_current = m_free.back();
+    m_free.pop_back();
+    m_buffer = m_buffers[m_current];
+}
+
+void FileWriter::reap(bool wait) {
+    IoEngine::Completion done[16];
+    size_t count = 0;
+    do {
+        count = m_engine->reap(done, 16, wait);
+        for (size_t i = 0; i < count; ++i) {
+            unsigned index = done[i].index;
+            const Pending& pending = m_pending[index];
+            ssize_t result = done[i].result;
+            //部分写入时同步写出剩下的部分
+            if (result >= 0 && size_t(result) < pending.len) {
+                ssize_t more = pwriteAll(m_fd, m_buffers[index] + result, pending.len - result, pending.offset + result);
+                result = more < 0 ? more : result + more;
+            }
+            //写入失败时丢弃数据，和同步模式一样
+            if (result < 0) {
+                std::cout << "FileWriter write " << m_path << " error: " << strerror(-result) << std::endl;
+            }
+            --m_inflight;
+            m_free.push_back(index);
+        }
+        wait = false;
+    } while (count == 16);
+}
+
+void FileWriter::writeAll(struct iovec* iov, int count) {
+    size_t total = 0;
+    for (int i = 0; i < count; ++i) {
+        total += iov[i].iov_len;
+    }
+    //写入失败时丢弃数据，日志不能阻塞或者抛出异常
+    m_used = 0;
+    if (m_fd < 0) {
+        return;
+    }
+    while (total > 0) {
+        ssize_t n = ::writev(m_fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cout << "FileWriter write " << m_path << " error: " << strerror(errno) << std::endl;
+            return;
+        }
+        m_fileSize += n;
+        total -= n;
+        //跳过已经写出的部分
+        while (count > 0 && size_t(n) >= iov->iov_len) {
+            n -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+//ConsoleWriter
+/*******************************************************************************/
+ConsoleWriter* ConsoleWriter::instance(int fd) {
+    //不析构，进程退出时由LogFlusher最后刷新一次
+    static ConsoleWriter* out = new ConsoleWriter(STDOUT_FILENO);
+    static ConsoleWriter* err = new ConsoleWriter(STDERR_FILENO);
+    return fd == STDOUT_FILENO ? out : err;
+}
+
+ConsoleWriter::ConsoleWriter(int fd) : m_tty(isatty(fd)) {
+    FlushPolicy policy;
+    policy.bufferSize = 64 * 1024;
+    setPolicy(policy);
+    m_writer.attach(fd, fd == STDOUT_FILENO ? "stdout" : "stderr");
+}
+
+void ConsoleWriter::write(const char* data, size_t len, LogLevel level) {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    m_writer.write(data, len);
+    if (m_tty || level >= m_writer.getPolicy().level) {
+        m_writer.flush();
+    }
+}
+
+void ConsoleWriter::flush() {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    m_writer.flush();
+}
+
+void ConsoleWriter::setPolicy(const FlushPolicy& policy) {
+    //标准输出不能异步写、不能O_DIRECT
+    FlushPolicy console;
+    console.bufferSize = policy.bufferSize;
+    console.intervalMs = policy.intervalMs;
+    console.level = policy.level;
+    {
+        std::lock_guard<std::mutex> lock_guard(m_mutex);
+        m_writer.setPolicy(console);
+    }
+    LogFlusher::instance()->add(this, [this]() {
+        flush();
+    }, console.intervalMs);
+}
+
+//LogFlusher
+/*******************************************************************************/
+LogFlusher* LogFlusher::instance() {
+    //不析构，进程退出时其他静态对象析构后仍可能被调用
+    static LogFlusher* flusher = new LogFlusher();
+    return flusher;
+}
+
+LogFlusher::LogFlusher() {
+    m_thread = std::thread(&LogFlusher::run, this);
+    m_thread.detach();
+    std::atexit([]() {
+        LogFlusher::instance()->m_exiting.store(true, std::memory_order_relaxed);
+        LogFlusher::instance()->flushAll();
+    });
+}
+
+void LogFlusher::add(const void* key, std::function<void()> flush, uint32_t intervalMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (intervalMs == 0) {
+        erase(lock, key);
+        return;
+    }
+    //正在进行的调用继续使用旧的刷新函数
+    Entry& entry = m_entries[key];
+    entry.flush = std::make_shared<const std::function<void()>>(std::move(flush));
+    entry.interval = std::chrono::milliseconds(intervalMs);
+    entry.deadline = Clock::now() + entry.interval;
+    m_cond.notify_one();
+}
+
+void LogFlusher::remove(const void* key) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    erase(lock, key);
+}
+
+void LogFlusher::erase(std::unique_lock<std::mutex>& lock, const void* key) {
+    while (true) {
+        auto it = m_entries.find(key);
+        if (it == m_entries.end()) {
+            return;
+        }
+        //刷新函数中注销自己时不能等待
+        if (!it->second.running || it->second.runner == std::this_thread::get_id()) {
+            m_entries.erase(it);
+            return;
+        }
+        m_idle.wait(lock);
+    }
+}
+
+void LogFlusher::call(std::unique_lock<std::mutex>& lock, const std::vector<Call>& calls) {
+    lock.unlock();
+    for (const Call& c : calls) {
+        (*c.flush)();
+    }
+    lock.lock();
+    //下一次从调用结束时算起，慢的刷新函数不会连续执行，等待remove的线程能拿到锁
+    Clock::time_point now = Clock::now();
+    for (const Call& c : calls) {
+        auto it = m_entries.find(c.key);
+        if (it != m_entries.end()) {
+            it->second.running = false;
+            it->second.deadline = now + it->second.interval;
+        }
+    }
+    m_idle.notify_all();
+    m_cond.notify_one();
+}
+
+void LogFlusher::flushAll() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    //刷新线程正在调用的先等它结束
+    m_idle.wait(lock, [this]() {
+        for (auto& e : m_entries) {
+            if (e.second.running && e.second.runner != std::this_thread::get_id()) {
+                return false;
+            }
+        }
+        return true;
+    });
+    std::vector<Call> calls;
+    for (auto& e : m_entries) {
+        if (!e.second.running) {
+            e.second.running = true;
+            e.second.runner = std::this_thread::get_id();
+            calls.push_back(Call{e.first, e.second.flush});
+        }
+    }
+    call(lock, calls);
+}
+
+void LogFlusher::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::vector<Call> calls;
+    while (true) {
+        if (m_entries.empty()) {
+            m_cond.wait(lock);
+            continue;
+        }
+        //取出到期的刷新函数，释放锁后调用，调用期间add/remove不被阻塞
+        Clock::time_point now = Clock::now();
+        Clock::time_point next = Clock::time_point::max();
+        calls.clear();
+        for (auto& e : m_entries) {
+            Entry& entry = e.second;
+            if (entry.deadline <= now && !entry.running) {
+                entry.running = true;
+                entry.runner = std::this_thread::get_id();
+                calls.push_back(Call{e.first, entry.flush});
+            }
+            //flushAll正在调用的，结束时会唤醒
+            if (!entry.running) {
+                next = std::min(next, entry.deadline);
+            }
+        }
+        if (!calls.empty()) {
+            call(lock, calls);
+            continue;
+        }
+        m_cond.wait_until(lock, next);
+    }
+}
+
+}
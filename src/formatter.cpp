@@ -1,85 +1,294 @@
 #include <iostream>
-#include <sstream>
+#include <cstring>
 #include <utility>
 #include <map>
-#include <functional>
 #include "formatter.hpp"
+#include "logformat.hpp"
 
 namespace daq {
+
+/// @brief appendPadded 把整数补零到固定位数后追加到buffer
+static void appendPadded(std::string& buffer, uint64_t value, uint32_t digits) {
+    char tmp[20];
+    for (uint32_t i = digits; i > 0; --i) {
+        tmp[i - 1] = char('0' + value % 10);
+        value /= 10;
+    }
+    buffer.append(tmp, digits);
+}
+
+static const uint64_t s_pow10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL,
+    1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+};
+
 //Formatter
 /*******************************************************************************/
 Formatter::Formatter(const std::string& pattern): m_pattern(pattern) {
     patternParser();
 }
 
-std::string Formatter::format(LogEvent::sptr event) {
-    std::stringstream ss;
-    for (auto& f : m_items) {
-        f->addFormat(ss, event);
+Formatter::Formatter(const Formatter& rth): m_pattern(rth.m_pattern) {
+    patternParser();
+}
+
+Formatter& Formatter::operator=(const Formatter& rth) {
+    if (this != &rth) {
+        m_pattern = rth.m_pattern;
+        patternParser();
     }
-    return ss.str();
+    return *this;
 }
 
-void Formatter::patternParser() {
-    //tuple<str,fmt,type>
-    //type = 0 -> 直接输出字符串
-    //type = 1 -> 输出固定的格式%p...
-    //type = 2 -> 输出带有格式的时间
-    std::vector<std::tuple<std::string, std::string, int>> vec;
-    for (unsigned int i = 0; i < m_pattern.size(); ++i) {
-        std::string tmp;
-        tmp += m_pattern[i];
-        if (tmp != "%") {
-            vec.emplace_back(std::move(tmp), "", 0);
-        } else {
-            tmp = m_pattern[++i];
-            if (tmp == "%") {
-                vec.emplace_back(std::move(tmp), "", 0);
-            } else if(tmp == "d") {
-                auto rihgt_brac_pos = m_pattern.find_first_of('}', ++i);
-                auto time_str = m_pattern.substr(i + 1, rihgt_brac_pos - i - 1);
-                vec.emplace_back("d", std::move(time_str), 2);
-                i = rihgt_brac_pos;
+std::string Formatter::format(LogEvent::sptr event) {
+    std::string buffer;
+    formatTo(buffer, *event);
+    return buffer;
+}
+
+boost::string_view Formatter::format(const LogEvent& event, std::string& buffer) const {
+    buffer.clear();
+    formatTo(buffer, event);
+    return boost::string_view(buffer.data(), buffer.size());
+}
+
+void Formatter::formatTo(std::string& buffer, const LogEvent& event) const {
+    const char* strings = m_strings.data();
+    const uint64_t timestamp = event.getTimestamp();
+    for (const Op& op : m_program) {
+        switch (op.code) {
+        case OpCode::LITERAL:
+            buffer.append(strings + op.offset, op.length);
+            break;
+        case OpCode::MESSAGE:
+            buffer.append(event.getContent());
+            break;
+        case OpCode::LEVEL:
+            buffer.append(LoglevelToCStr(event.getLevel()));
+            break;
+        case OpCode::THREAD_ID:
+            appendUInt(buffer, event.getThreadId());
+            break;
+        case OpCode::DATE_TIME:
+            appendTime(buffer, op, time_t(timestamp / 1000000000));
+            break;
+        case OpCode::SUB_SECOND:
+            appendPadded(buffer, timestamp % 1000000000 / s_pow10[9 - op.arg], op.arg);
+            break;
+        case OpCode::ELAPSED: {
+            uint64_t start = LogEvent::getStartTime();
+            appendUInt(buffer, timestamp > start ? (timestamp - start) / 1000000 : 0);
+            break;
+        }
+        case OpCode::FILE_NAME:
+            buffer.append(event.getFileName());
+            break;
+        case OpCode::LINE:
+            appendInt(buffer, event.getLineNumber());
+            break;
+        case OpCode::THREAD_NAME:
+            buffer.append(event.getThreadName());
+            break;
+        case OpCode::FIBER_ID:
+            if (event.getFiber()) {
+                appendHex(buffer, reinterpret_cast<uintptr_t>(event.getFiber()));
             } else {
-                vec.emplace_back(std::move(tmp), "", 1);
+                buffer.append("{not-valid}");
             }
+            break;
+        case OpCode::CLASS_NAME: {
+            auto name = event.getLocationInfo().getClassNameView();
+            buffer.append(name.data(), name.size());
+            break;
+        }
+        case OpCode::METHOD_NAME: {
+            auto name = event.getLocationInfo().getMethodNameView();
+            buffer.append(name.data(), name.size());
+            break;
+        }
+        case OpCode::LOGGER_NAME:
+            buffer.append(event.getLoggerName());
+            break;
+        case OpCode::NEW_LINE:
+            buffer.push_back('\n');
+            break;
+        case OpCode::TAB:
+            buffer.push_back('\t');
+            break;
+        }
+    }
+}
+
+void Formatter::appendTime(std::string& buffer, const Op& op, time_t second) const {
+    TimeCache& cache = m_timeCaches[op.arg];
+    char tmp[128];
+
+    //读缓存: seq为偶数且前后一致时读到的是完整的结果
+    uint32_t seq = cache.seq.load(std::memory_order_acquire);
+    if (!(seq & 1) && cache.second.load(std::memory_order_relaxed) == second) {
+        uint64_t words[TimeCache::WORDS];
+        uint32_t length = cache.length.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < TimeCache::WORDS; ++i) {
+            words[i] = cache.data[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (cache.seq.load(std::memory_order_relaxed) == seq) {
+            buffer.append(reinterpret_cast<const char*>(words), length);
+            return;
+        }
+    }
+
+    //缓存未命中，每秒只发生一次
+    struct tm tm;
+    localtime_r(&second, &tm);
+    size_t length = std::strftime(tmp, sizeof(tmp), m_strings.data() + op.offset, &tm);
+    buffer.append(tmp, length);
+
+    //其他线程正在写时放弃更新缓存
+    if (length > sizeof(cache.data) || (seq & 1)
+            || !cache.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) {
+        return;
+    }
+    //seq变为奇数之后才能写数据，读者看到新数据时一定也看到奇数的seq
+    std::atomic_thread_fence(std::memory_order_release);
+    uint64_t words[TimeCache::WORDS] = {0};
+    memcpy(words, tmp, length);
+    cache.length.store(uint32_t(length), std::memory_order_relaxed);
+    for (size_t i = 0; i < TimeCache::WORDS; ++i) {
+        cache.data[i].store(words[i], std::memory_order_relaxed);
+    }
+    cache.second.store(second, std::memory_order_relaxed);
+    cache.seq.store(seq + 2, std::memory_order_release);
+}
+
+void Formatter::addDateTime(const std::string& timeFmt) {
+    std::string segment;
+    for (size_t i = 0; i < timeFmt.size(); ++i) {
+        if (timeFmt[i] != '%' || i + 1 == timeFmt.size()) {
+            segment += timeFmt[i];
+            continue;
+        }
+        //%N %3N %6N %9N为亚秒，其余交给strftime
+        uint32_t digits = 0;
+        size_t next = i + 1;
+        if (timeFmt[next] == 'N') {
+            digits = 9;
+        } else if (next + 1 < timeFmt.size() && timeFmt[next + 1] == 'N'
+                   && (timeFmt[next] == '3' || timeFmt[next] == '6' || timeFmt[next] == '9')) {
+            digits = timeFmt[next] - '0';
+            ++next;
         }
+        if (digits == 0) {
+            segment += timeFmt[i];
+            segment += timeFmt[next];
+            i = next;
+            continue;
+        }
+        if (!segment.empty()) {
+            addOp(OpCode::DATE_TIME, segment, m_timeCacheCount++);
+            segment.clear();
+        }
+        addOp(OpCode::SUB_SECOND, "", digits);
+        i = next;
     }
+    if (!segment.empty()) {
+        addOp(OpCode::DATE_TIME, segment, m_timeCacheCount++);
+    }
+}
 
-    static std::map<std::string, std::function<FormatItem::sptr(const std::string str)>> s_fmt_items = {
-#define XX(str, F) \
-		{#str, [](const std::string fmt){ return FormatItem::sptr(new F(fmt));}} \
-
-        XX(m, MessageFormatItem),
-        XX(p, LevelFormatItem),
-        XX(n, NewLineFormatItem),
-        XX(t, ThreadIdFormatItem),
-        XX(d, DateTimeFormatItem),
-        XX(f, FileNameFormatItem),
-        XX(l, LineNumberFormatItem),
-        XX(T, TabFormatItem),
-        XX(C, ClassFormatItem),
-        XX(M, MethodFormatItem),
-        XX(F, FiberFormatItem),
-        XX(N, LoggerNameFormatItem),
+void Formatter::addOp(OpCode code, const std::string& arg, uint32_t opArg) {
+    if (code == OpCode::LITERAL) {
+        if (arg.empty()) {
+            return;
+        }
+        //和前一条普通字符串指令相邻时直接合并
+        if (!m_program.empty() && m_program.back().code == OpCode::LITERAL
+                && m_program.back().offset + m_program.back().length == m_strings.size()) {
+            m_program.back().length += arg.size();
+            m_strings += arg;
+            return;
+        }
+    }
+    Op op;
+    op.code = code;
+    op.offset = m_strings.size();
+    op.length = arg.size();
+    op.arg = opArg;
+    m_program.push_back(op);
+    m_strings += arg;
+    //时间格式交给strftime，需要以'\0'结尾
+    if (code == OpCode::DATE_TIME) {
+        m_strings.push_back('\0');
+    }
+}
+
+void Formatter::patternParser() {
+    static const std::map<char, OpCode> s_fmt_items = {
+#define XX(c, code) \
+        {c, OpCode::code}
+
+        XX('m', MESSAGE),
+        XX('p', LEVEL),
+        XX('n', NEW_LINE),
+        XX('t', THREAD_ID),
+        XX('h', THREAD_NAME),
+        XX('f', FILE_NAME),
+        XX('l', LINE),
+        XX('T', TAB),
+        XX('C', CLASS_NAME),
+        XX('M', METHOD_NAME),
+        XX('F', FIBER_ID),
+        XX('N', LOGGER_NAME),
+        XX('r', ELAPSED),
 
 #undef XX
     };
 
-    for (auto& ele : vec) {
-        if (std::get<2>(ele) == 0) {
-            m_items.emplace_back(new StrFormatItem(std::get<0>(ele)));
-        } else if(std::get<2>(ele) == 1) {
-            auto it = s_fmt_items.find(std::get<0>(ele));
-            if (it != s_fmt_items.end()) {
-                m_items.emplace_back(it->second(std::get<1>(ele)));
-            } else {
-                m_items.emplace_back(new StrFormatItem("<Fmt Error> : %" + std::get<0>(ele)));
+    m_program.clear();
+    m_strings.clear();
+    m_timeCacheCount = 0;
+    std::string literal;
+    for (size_t i = 0; i < m_pattern.size(); ++i) {
+        char c = m_pattern[i];
+        //末尾单独的'%'按普通字符输出
+        if (c != '%' || i + 1 == m_pattern.size()) {
+            literal += c;
+            continue;
+        }
+        c = m_pattern[++i];
+        if (c == '%') {
+            literal += c;
+            continue;
+        }
+
+        addOp(OpCode::LITERAL, literal);
+        literal.clear();
+        if (c == 'd') {
+            std::string timeFmt = "%Y-%m-%d %H:%M:%S";
+            if (i + 1 < m_pattern.size() && m_pattern[i + 1] == '{') {
+                auto right_brac_pos = m_pattern.find_first_of('}', i + 1);
+                if (right_brac_pos == std::string::npos) {
+                    right_brac_pos = m_pattern.size();
+                }
+                timeFmt = m_pattern.substr(i + 2, right_brac_pos - i - 2);
+                i = right_brac_pos;
+            }
+            addDateTime(timeFmt);
+            continue;
+        }
+
+        auto it = s_fmt_items.find(c);
+        if (it != s_fmt_items.end()) {
+            if (it->second == OpCode::FIBER_ID) {
+                LogEvent::setCaptureFiber(true);
             }
-        } else if(std::get<2>(ele) == 2) {
-            m_items.emplace_back(new DateTimeFormatItem(std::get<1>(ele)));
+            addOp(it->second);
+        } else {
+            addOp(OpCode::LITERAL, std::string("<Fmt Error> : %") + c);
         }
     }
+    addOp(OpCode::LITERAL, literal);
+    m_timeCaches.reset(m_timeCacheCount ? new TimeCache[m_timeCacheCount] : nullptr);
 }
 
 }
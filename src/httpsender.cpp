@@ -0,0 +1,518 @@
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <zlib.h>
+
+#include "httpsender.hpp"
+
+namespace daq {
+
+//HttpBatch
+/*******************************************************************************/
+void HttpBatch::add(const char* data, size_t len) {
+    //去掉首尾的空白和外层的方括号
+    while (len > 0 && isspace(static_cast<unsigned char>(data[0]))) {
+        ++data;
+        --len;
+    }
+    while (len > 0 && isspace(static_cast<unsigned char>(data[len - 1]))) {
+        --len;
+    }
+    if (len >= 2 && data[0] == '[' && data[len - 1] == ']') {
+        ++data;
+        len -= 2;
+    }
+    if (len == 0) {
+        return;
+    }
+    m_body.push_back(m_count == 0 ? '[' : ',');
+    m_body.append(data, len);
+    ++m_count;
+}
+
+std::string HttpBatch::take() {
+    if (m_count == 0) {
+        m_body = "[";
+    }
+    m_body.push_back(']');
+    std::string body;
+    body.swap(m_body);
+    m_count = 0;
+    return body;
+}
+
+//HttpSender
+/*******************************************************************************/
+//写入Spool的记录的标志
+static const uint32_t SPOOL_GZIP = 1;
+
+struct HttpSender::Deflater {
+    z_stream stream;
+    bool ok;
+
+    Deflater() {
+        memset(&stream, 0, sizeof(stream));
+        //windowBits加16输出gzip格式；在I/O线程中压缩，用最快的等级
+        ok = deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+    ~Deflater() {
+        if (ok) {
+            deflateEnd(&stream);
+        }
+    }
+};
+
+static size_t discardResponse(char*, size_t size, size_t nmemb, void*) {
+    return size * nmemb;
+}
+
+HttpSender::HttpSender(const std::string& url, const HttpSendPolicy& policy, const SpoolPolicy& spool)
+    : m_url(url), m_policy(policy), m_random(std::random_device()()) {
+    //curl_global_init只调用一次，C++11保证局部静态变量的初始化是线程安全的
+    static const CURLcode global = curl_global_init(CURL_GLOBAL_ALL);
+    (void)global;
+    if (m_policy.maxInflight == 0) {
+        m_policy.maxInflight = 1;
+    }
+    m_policy.spoolInflight = std::min(std::max<size_t>(m_policy.spoolInflight, 1), m_policy.maxInflight);
+    m_multi = curl_multi_init();
+    if (m_multi == nullptr) {
+        std::cout << "HttpSender " << m_url << " curl_multi_init failed" << std::endl;
+        return;
+    }
+    //连接数不超过同时发送的请求数，完成的连接留在缓存中复用
+    curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, long(m_policy.maxInflight));
+    curl_multi_setopt(m_multi, CURLMOPT_MAXCONNECTS, long(m_policy.maxInflight));
+    m_headers = curl_slist_append(m_headers, "Content-Type:application/json;charset=UTF-8");
+    m_gzipHeaders = curl_slist_append(m_gzipHeaders, "Content-Type:application/json;charset=UTF-8");
+    m_gzipHeaders = curl_slist_append(m_gzipHeaders, "Content-Encoding: gzip");
+    //上次没有发送完的请求在I/O线程启动后继续发送
+    if (!spool.dir.empty()) {
+        m_spool = Spool::open(spool);
+    }
+    m_thread = std::thread(&HttpSender::run, this);
+}
+
+HttpSender::~HttpSender() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock_guard(m_mutex);
+            m_stop = true;
+            m_stopDeadline = Clock::now() + std::chrono::milliseconds(m_policy.timeoutMs);
+        }
+        curl_multi_wakeup(m_multi);
+        m_thread.join();
+    }
+    for (CURL* easy : m_idle) {
+        curl_easy_cleanup(easy);
+    }
+    if (m_multi) {
+        curl_multi_cleanup(m_multi);
+    }
+    curl_slist_free_all(m_headers);
+    curl_slist_free_all(m_gzipHeaders);
+}
+
+void HttpSender::post(std::string&& body, bool gzip) {
+    if (m_multi == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock_guard(m_mutex);
+        //积压超过上限时丢弃最旧的请求，保留最新的日志；有Spool时由I/O线程写入Spool
+        size_t count = 0;
+        while (!m_spool && !m_queue.empty() && m_queuedBytes + body.size() > m_policy.maxBacklog) {
+            m_queuedBytes -= m_queue.front()->body.size();
+            m_queue.pop_front();
+            ++count;
+        }
+        if (count > 0) {
+            drop(count, "backlog full");
+        }
+        m_queuedBytes += body.size();
+        m_posted.emplace_back(new Request{std::move(body), false, 0, false, 0, gzip, m_postSeq++});
+    }
+    curl_multi_wakeup(m_multi);
+}
+
+bool HttpSender::waitIdle(uint32_t timeoutMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_idleCond.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() {
+        return idle();
+    });
+}
+
+size_t HttpSender::pending() {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    return m_posted.size() + m_queue.size() + m_spilling + m_inflight;
+}
+
+uint64_t HttpSender::getSent() {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    return m_sent;
+}
+
+uint64_t HttpSender::getDropped() {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    return m_dropped;
+}
+
+void HttpSender::drop(size_t count, const char* reason) {
+    m_dropped += count;
+    //最多每秒打印一次，避免服务器不可用时刷屏
+    Clock::time_point now = Clock::now();
+    if (now - m_lastDropReport >= std::chrono::seconds(1)) {
+        std::cout << "HttpSender " << m_url << " " << reason << ", dropped "
+                  << m_dropped - m_reported << " requests" << std::endl;
+        m_reported = m_dropped;
+        m_lastDropReport = now;
+    }
+}
+
+bool HttpSender::start(std::unique_ptr<Request> request) {
+    CURL* easy = nullptr;
+    if (m_idle.empty()) {
+        easy = curl_easy_init();
+        if (easy == nullptr) {
+            //Spool中的请求留在Spool中
+            if (!request->spooled) {
+                drop(1, "curl_easy_init failed");
+            }
+            return false;
+        }
+        curl_easy_setopt(easy, CURLOPT_URL, m_url.c_str());
+        curl_easy_setopt(easy, CURLOPT_POST, 1L);
+        curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, long(m_policy.timeoutMs));
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, discardResponse);
+    } else {
+        easy = m_idle.back();
+        m_idle.pop_back();
+    }
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, request->gzip ? m_gzipHeaders : m_headers);
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDS, request->body.data());
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE, curl_off_t(request->body.size()));
+    curl_multi_add_handle(m_multi, easy);
+    m_active[easy] = std::move(request);
+    ++m_inflight;
+    return true;
+}
+
+void HttpSender::complete(CURL* easy, CURLcode result) {
+    long code = 0;
+    curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &code);
+    curl_multi_remove_handle(m_multi, easy);
+    std::unique_ptr<Request> request = std::move(m_active[easy]);
+    m_active.erase(easy);
+    m_idle.push_back(easy);
+
+    bool ok = result == CURLE_OK && code >= 200 && code < 300;
+    //连接错误、超时和服务器暂时不可用时重试，其他4xx重试也不会成功
+    bool retry = !ok && (result != CURLE_OK || code == 408 || code == 429 || code >= 500);
+    retry = retry && (m_policy.maxRetries == 0 || request->retries < m_policy.maxRetries);
+    if (request->spooled) {
+        completeSpooled(*request, retry);
+    }
+
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    --m_inflight;
+    if (request->spooled) {
+        --m_spoolInflight;
+    }
+    if (ok) {
+        if (m_failures > 0) {
+            std::cout << "HttpSender " << m_url << " recovered after " << m_failures << " failures" << std::endl;
+        }
+        m_failures = 0;
+        ++m_sent;
+    } else if (retry) {
+        if (m_failures == 0) {
+            std::cout << "HttpSender " << m_url << " failed: "
+                      << (result != CURLE_OK ? curl_easy_strerror(result) : ("HTTP " + std::to_string(code)).c_str())
+                      << ", retrying" << std::endl;
+        }
+        //指数退避，加上最多25%的抖动，避免多个进程同时重连；
+        //退避开始前已经在发送的请求随后失败时不再加倍
+        Clock::time_point now = Clock::now();
+        if (now >= m_backoffUntil) {
+            uint64_t delay = uint64_t(m_policy.retryMinMs) << std::min<uint32_t>(m_failures, 20);
+            delay = std::min<uint64_t>(delay, m_policy.retryMaxMs);
+            delay -= delay * (m_random() % 26) / 100;
+            m_backoffUntil = now + std::chrono::milliseconds(delay);
+            ++m_failures;
+        }
+        if (!request->spooled) {
+            //同时失败的几个请求按post的顺序放回，不会颠倒
+            ++request->retries;
+            m_queuedBytes += request->body.size();
+            auto pos = std::find_if(m_queue.begin(), m_queue.end(), [&](const std::unique_ptr<Request>& queued) {
+                return queued->seq > request->seq;
+            });
+            m_queue.insert(pos, std::move(request));
+        }
+    } else {
+        std::string reason = result != CURLE_OK ? curl_easy_strerror(result) : "HTTP " + std::to_string(code);
+        drop(1, reason.c_str());
+    }
+    if (idle()) {
+        m_idleCond.notify_all();
+    }
+}
+
+void HttpSender::takePosted() {
+    RequestQueue posted;
+    {
+        std::lock_guard<std::mutex> lock_guard(m_mutex);
+        if (m_posted.empty()) {
+            return;
+        }
+        posted.swap(m_posted);
+    }
+    //写日志的线程只交出请求体，压缩在这里进行，不持有锁
+    int64_t delta = 0;
+    for (auto& request : posted) {
+        if (request->compress) {
+            size_t size = request->body.size();
+            compress(*request);
+            delta += int64_t(request->body.size()) - int64_t(size);
+        }
+    }
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    m_queuedBytes += delta;
+    for (auto& request : posted) {
+        m_queue.push_back(std::move(request));
+    }
+}
+
+void HttpSender::compress(Request& request) {
+    request.compress = false;
+    if (!m_deflater) {
+        m_deflater.reset(new Deflater());
+    }
+    if (!m_deflater->ok) {
+        return;
+    }
+    z_stream& stream = m_deflater->stream;
+    deflateReset(&stream);
+    m_gzip.resize(deflateBound(&stream, request.body.size()));
+    stream.next_in = reinterpret_cast<Bytef*>(&request.body[0]);
+    stream.avail_in = request.body.size();
+    stream.next_out = reinterpret_cast<Bytef*>(&m_gzip[0]);
+    stream.avail_out = m_gzip.size();
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+        return;
+    }
+    m_gzip.resize(stream.total_out);
+    request.body.swap(m_gzip);
+    request.gzip = true;
+}
+
+void HttpSender::spill(RequestQueue& requests) {
+    size_t failed = 0;
+    for (auto& request : requests) {
+        if (!m_spool->push(request->body.data(), request->body.size(), request->gzip ? SPOOL_GZIP : 0)) {
+            ++failed;
+        }
+    }
+    requests.clear();
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    m_spilling = 0;
+    if (failed > 0) {
+        drop(failed, "spool write failed");
+    }
+    if (idle()) {
+        m_idleCond.notify_all();
+    }
+}
+
+void HttpSender::syncSpool() {
+    uint64_t lost = m_spool->lostSegments();
+    if (lost != m_spoolLost) {
+        //正在发送的请求完成时序号已经不在m_spoolSlots中，结果被忽略
+        m_spoolBase += m_spoolSlots.size();
+        m_spoolSlots.clear();
+        m_spoolLost = lost;
+    }
+}
+
+void HttpSender::completeSpooled(const Request& request, bool retry) {
+    syncSpool();
+    if (request.spoolSeq < m_spoolBase || request.spoolSeq - m_spoolBase >= m_spoolSlots.size()) {
+        return;
+    }
+    SpoolSlot& slot = m_spoolSlots[request.spoolSeq - m_spoolBase];
+    slot.inflight = false;
+    if (retry) {
+        slot.retries = request.retries + 1;
+    } else {
+        slot.done = true;
+    }
+    //成功或者不再重试的请求等前面的都完成后一起取走，进程退出后重发的只有没有取走的部分
+    size_t count = 0;
+    while (count < m_spoolSlots.size() && m_spoolSlots[count].done) {
+        ++count;
+    }
+    if (count > 0) {
+        m_spool->pop(count);
+        m_spoolSlots.erase(m_spoolSlots.begin(), m_spoolSlots.begin() + count);
+        m_spoolBase += count;
+    }
+}
+
+int HttpSender::drainSpool() {
+    uint32_t delay = m_spool->delayMs();
+    if (delay > 0) {
+        return delay;
+    }
+    syncSpool();
+    size_t free = 0;
+    {
+        //限速时每次只发送一个，按取走的字节数计算等待时间
+        std::lock_guard<std::mutex> lock_guard(m_mutex);
+        size_t limit = m_spool->getPolicy().drainRate > 0 ? 1 : m_policy.spoolInflight;
+        if (m_spoolInflight < limit && m_inflight < m_policy.maxInflight) {
+            free = std::min(limit - m_spoolInflight, m_policy.maxInflight - m_inflight);
+        }
+    }
+    std::vector<std::string> records;
+    std::vector<uint32_t> flags;
+    auto startSpooled = [&](size_t index, std::string& body, uint32_t flag) {
+        SpoolSlot& slot = m_spoolSlots[index];
+        std::unique_ptr<Request> request(new Request{std::move(body), (flag & SPOOL_GZIP) != 0,
+                                                     slot.retries, true, m_spoolBase + index, false, 0});
+        std::lock_guard<std::mutex> lock_guard(m_mutex);
+        if (start(std::move(request))) {
+            slot.inflight = true;
+            ++m_spoolInflight;
+        }
+        --free;
+    };
+    //先重发失败的请求，再读出新的请求
+    for (size_t i = 0; i < m_spoolSlots.size() && free > 0; ++i) {
+        if (m_spoolSlots[i].inflight || m_spoolSlots[i].done) {
+            continue;
+        }
+        if (m_spool->peek(records, 1, SIZE_MAX, i, &flags) == 0) {
+            break;
+        }
+        startSpooled(i, records[0], flags[0]);
+    }
+    if (free > 0) {
+        size_t count = m_spool->peek(records, free, SIZE_MAX, m_spoolSlots.size(), &flags);
+        for (size_t i = 0; i < count; ++i) {
+            m_spoolSlots.push_back(SpoolSlot{false, false, 0});
+            startSpooled(m_spoolSlots.size() - 1, records[i], flags[i]);
+        }
+    }
+    return 1000;
+}
+
+void HttpSender::run() {
+    while (true) {
+        int timeout = 1000;
+        RequestQueue spilled;
+        bool drain = false;
+        takePosted();
+        {
+            std::lock_guard<std::mutex> lock_guard(m_mutex);
+            Clock::time_point now = Clock::now();
+            if (m_stop && (now >= m_stopDeadline || idle())) {
+                break;
+            }
+            //服务器失败或者积压过多时请求写入Spool；按顺序发送时Spool发送完之前新的请求也写入Spool，
+            //并且等正在发送的新请求都完成后再写，失败的请求放回队列后排在后面的请求之前写入，
+            //否则恢复后新的请求直接发送，Spool中还有请求时给它留一个连接，不会被新的请求一直占满
+            bool ordered = m_policy.spoolInflight == 1;
+            bool spooling = m_spool && (m_spoolInflight > 0 || !m_spool->empty());
+            bool toSpool = m_spool && (m_failures > 0 || m_queuedBytes > m_policy.maxBacklog || (ordered && spooling));
+            if (toSpool && (!ordered || m_inflight == m_spoolInflight)) {
+                spilled.swap(m_queue);
+                m_queuedBytes = 0;
+                m_spilling = spilled.size();
+            }
+            size_t maxLive = m_policy.maxInflight;
+            if (spooling && maxLive > 1 && m_spoolInflight == 0) {
+                --maxLive;
+            }
+            while (!toSpool && m_inflight < maxLive && !m_queue.empty() && now >= m_backoffUntil) {
+                std::unique_ptr<Request> request = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_queuedBytes -= request->body.size();
+                start(std::move(request));
+            }
+            drain = m_spool && !m_stop && m_inflight < m_policy.maxInflight && now >= m_backoffUntil;
+            if ((!m_queue.empty() || (m_spool && m_spoolInflight == 0)) && now < m_backoffUntil) {
+                timeout = std::chrono::duration_cast<std::chrono::milliseconds>(m_backoffUntil - now).count() + 1;
+            }
+            if (m_stop) {
+                timeout = std::min<int64_t>(timeout,
+                    std::chrono::duration_cast<std::chrono::milliseconds>(m_stopDeadline - now).count() + 1);
+            }
+            if (idle()) {
+                m_idleCond.notify_all();
+            }
+        }
+        if (!spilled.empty()) {
+            spill(spilled);
+        }
+        if (drain) {
+            timeout = std::min(timeout, drainSpool());
+        }
+        int running = 0;
+        curl_multi_perform(m_multi, &running);
+        int left = 0;
+        while (CURLMsg* msg = curl_multi_info_read(m_multi, &left)) {
+            if (msg->msg == CURLMSG_DONE) {
+                complete(msg->easy_handle, msg->data.result);
+                //空出的位置马上发送下一个请求
+                timeout = 0;
+            }
+        }
+        //有请求在发送时curl_multi_poll会按curl内部的超时提前返回，post和析构用curl_multi_wakeup唤醒
+        curl_multi_poll(m_multi, nullptr, 0, timeout, nullptr);
+    }
+
+    //超过析构的等待时间，剩下的请求写入Spool或者丢弃；正在发送的Spool中的请求还在Spool中
+    RequestQueue left;
+    {
+        std::lock_guard<std::mutex> lock_guard(m_mutex);
+        for (auto& active : m_active) {
+            curl_multi_remove_handle(m_multi, active.first);
+            m_idle.push_back(active.first);
+            if (!active.second->spooled) {
+                left.push_back(std::move(active.second));
+            }
+        }
+        //没有压缩的请求按原文写入Spool
+        for (RequestQueue* queue : {&m_queue, &m_posted}) {
+            for (auto& request : *queue) {
+                left.push_back(std::move(request));
+            }
+            queue->clear();
+        }
+        //m_active没有顺序，按post的顺序写入
+        std::stable_sort(left.begin(), left.end(), [](const std::unique_ptr<Request>& a, const std::unique_ptr<Request>& b) {
+            return a->seq < b->seq;
+        });
+        m_active.clear();
+        m_queuedBytes = 0;
+        m_inflight = 0;
+        m_spoolInflight = 0;
+        if (!m_spool && !left.empty()) {
+            m_lastDropReport = Clock::time_point();
+            drop(left.size(), "shutting down");
+            left.clear();
+        }
+    }
+    if (!left.empty()) {
+        std::cout << "HttpSender " << m_url << " shutting down, spooled " << left.size() << " requests" << std::endl;
+        spill(left);
+    }
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    m_idleCond.notify_all();
+}
+
+}
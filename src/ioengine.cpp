@@ -0,0 +1,387 @@
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <condition_variable>
+
+#include <unistd.h>
+#include <sys/uio.h>
+
+#if defined(__linux__) && !defined(DAQ_LOG_NO_IO_URING) && __has_include(<linux/io_uring.h>)
+#define DAQ_LOG_HAS_IO_URING 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "ioengine.hpp"
+
+namespace daq {
+
+ssize_t pwriteAll(int fd, const char* data, size_t len, uint64_t offset) {
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = ::pwrite(fd, data + total, len - total, offset + total);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        total += n;
+    }
+    return total;
+}
+
+#ifdef DAQ_LOG_HAS_IO_URING
+//UringEngine 直接使用系统调用，不依赖liburing
+/*******************************************************************************/
+class UringEngine : public IoEngine {
+    public:
+        ~UringEngine() {
+            if (m_sqes) {
+                munmap(m_sqes, m_sqesSize);
+            }
+            if (m_cqRing && m_cqRing != m_sqRing) {
+                munmap(m_cqRing, m_cqRingSize);
+            }
+            if (m_sqRing) {
+                munmap(m_sqRing, m_sqRingSize);
+            }
+            if (m_fd >= 0) {
+                ::close(m_fd);
+            }
+        }
+
+        /// @brief init 创建io_uring并注册缓冲区，失败时返回false
+        bool init(const std::vector<char*>& buffers, size_t bufferSize) {
+            struct io_uring_params params;
+            memset(&params, 0, sizeof(params));
+            m_fd = syscall(__NR_io_uring_setup, unsigned(buffers.size()), &params);
+            if (m_fd < 0) {
+                return false;
+            }
+            m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+            bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single) {
+                m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+            }
+            m_sqRing = map(m_sqRingSize, IORING_OFF_SQ_RING);
+            if (!m_sqRing) {
+                return false;
+            }
+            m_cqRing = single ? m_sqRing : map(m_cqRingSize, IORING_OFF_CQ_RING);
+            m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+            m_sqes = static_cast<struct io_uring_sqe*>(map(m_sqesSize, IORING_OFF_SQES));
+            if (!m_cqRing || !m_sqes) {
+                return false;
+            }
+            char* sq = static_cast<char*>(m_sqRing);
+            char* cq = static_cast<char*>(m_cqRing);
+            m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+            m_iovs.resize(buffers.size());
+            for (size_t i = 0; i < buffers.size(); ++i) {
+                m_iovs[i].iov_base = buffers[i];
+                m_iovs[i].iov_len = bufferSize;
+            }
+            //注册固定缓冲区省去每次请求时的页面映射，超出RLIMIT_MEMLOCK时退回到普通的writev请求
+            m_fixed = syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_BUFFERS,
+                              m_iovs.data(), unsigned(m_iovs.size())) == 0;
+            return true;
+        }
+
+        virtual void submit(int fd, unsigned index, size_t len, uint64_t offset) override {
+            if (m_fallback) {
+                m_fallback->submit(fd, index, len, offset);
+                return;
+            }
+            unsigned tail = *m_sqTail;
+            //请求数不超过缓冲区个数，提交队列不会满
+            unsigned slot = tail & m_sqMask;
+            struct io_uring_sqe* sqe = &m_sqes[slot];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->fd = fd;
+            sqe->off = offset;
+            sqe->user_data = index;
+            if (m_fixed) {
+                sqe->opcode = IORING_OP_WRITE_FIXED;
+                sqe->addr = reinterpret_cast<uint64_t>(m_iovs[index].iov_base);
+                sqe->len = len;
+                sqe->buf_index = index;
+            } else {
+                m_iovs[index].iov_len = len;
+                sqe->opcode = IORING_OP_WRITEV;
+                sqe->addr = reinterpret_cast<uint64_t>(&m_iovs[index]);
+                sqe->len = 1;
+            }
+            m_sqArray[slot] = slot;
+            __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+            ++m_toSubmit;
+        }
+
+        virtual size_t reap(Completion* done, size_t max, bool wait) override {
+            size_t count = peek(done, max);
+            if (m_fallback) {
+                return count + reapFallback(done + count, max - count, wait && count == 0);
+            }
+            //已经取到完成事件并且没有推迟的请求时，不需要系统调用
+            if (m_toSubmit == 0 && (count > 0 || !wait)) {
+                return count;
+            }
+            bool block = wait && count == 0;
+            while (true) {
+                int ret = syscall(__NR_io_uring_enter, m_fd, m_toSubmit, block ? 1 : 0,
+                                  block ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+                if (ret >= 0) {
+                    m_inflight += ret;
+                    m_toSubmit -= ret;
+                    break;
+                }
+                if (errno == EAGAIN || errno == EBUSY) {
+                    //完成队列满了，先取走已经完成的事件，取满时推迟到下一次提交
+                    count += peek(done + count, max - count);
+                    if (count == max) {
+                        return count;
+                    }
+                    block = block && count == 0;
+                    std::this_thread::yield();
+                } else if (errno != EINTR) {
+                    //其他错误重试也不会成功，之后的请求都交给写线程池
+                    std::cout << "IoEngine io_uring_enter error: " << strerror(errno)
+                              << ", falling back to threads" << std::endl;
+                    startFallback();
+                    return count + reapFallback(done + count, max - count, block);
+                }
+            }
+            return count + peek(done + count, max - count);
+        }
+
+        virtual const char* name() const override {
+            return m_fallback ? "threads" : "io_uring";
+        }
+
+    private:
+        /// @brief startFallback 撤回还没有提交给内核的请求，和之后的请求一起交给写线程池
+        void startFallback();
+        /// @brief reapFallback 取回内核中剩下的和写线程池完成的请求
+        size_t reapFallback(Completion* done, size_t max, bool wait);
+
+        /// @brief peek 从完成队列中取出事件，不进入内核
+        size_t peek(Completion* done, size_t max) {
+            unsigned head = *m_cqHead;
+            unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+            size_t count = 0;
+            while (head != tail && count < max) {
+                const struct io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+                done[count].index = unsigned(cqe.user_data);
+                done[count].result = cqe.res;
+                ++count;
+                ++head;
+            }
+            m_inflight -= count;
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+            return count;
+        }
+
+        void* map(size_t size, off_t offset) {
+            void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+            return ptr == MAP_FAILED ? nullptr : ptr;
+        }
+
+    private:
+        int m_fd = -1;
+        void* m_sqRing = nullptr;
+        void* m_cqRing = nullptr;
+        size_t m_sqRingSize = 0;
+        size_t m_cqRingSize = 0;
+        struct io_uring_sqe* m_sqes = nullptr;
+        size_t m_sqesSize = 0;
+        unsigned* m_sqTail = nullptr;
+        unsigned* m_sqArray = nullptr;
+        unsigned m_sqMask = 0;
+        unsigned* m_cqHead = nullptr;
+        unsigned* m_cqTail = nullptr;
+        unsigned m_cqMask = 0;
+        struct io_uring_cqe* m_cqes = nullptr;
+        std::vector<struct iovec> m_iovs;       //每个缓冲区一个，也用作writev的参数
+        bool m_fixed = false;                   //缓冲区是否注册成功
+        unsigned m_toSubmit = 0;                //已经放入提交队列还没有提交给内核的请求数
+        unsigned m_inflight = 0;                //已经提交给内核还没有取回的请求数
+        std::unique_ptr<IoEngine> m_fallback;   //io_uring_enter出错后使用的写线程池
+};
+#endif
+
+//ThreadEngine 没有io_uring时由共享的写线程池执行pwrite
+/*******************************************************************************/
+class ThreadEngine;
+
+/// 进程内唯一的写线程池，线程不退出，和LogFlusher一样不析构
+class IoThreadPool {
+    public:
+        struct Job {
+            ThreadEngine* engine;
+            int fd;
+            const char* data;
+            size_t len;
+            uint64_t offset;
+            unsigned index;
+        };
+
+        static IoThreadPool* instance() {
+            static IoThreadPool* pool = new IoThreadPool();
+            return pool;
+        }
+
+        void push(const Job& job) {
+            {
+                std::lock_guard<std::mutex> lock_guard(m_mutex);
+                m_jobs.push_back(job);
+            }
+            m_cond.notify_one();
+        }
+
+    private:
+        static constexpr int THREADS = 2;
+
+        IoThreadPool() {
+            for (int i = 0; i < THREADS; ++i) {
+                std::thread(&IoThreadPool::run, this).detach();
+            }
+        }
+        void run();
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::deque<Job> m_jobs;
+};
+
+class ThreadEngine : public IoEngine {
+    public:
+        explicit ThreadEngine(const std::vector<char*>& buffers) : m_buffers(buffers) {}
+
+        ~ThreadEngine() {
+            //线程池中的任务还引用着this
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this]() {
+                return m_inflight == 0;
+            });
+        }
+
+        virtual void submit(int fd, unsigned index, size_t len, uint64_t offset) override {
+            {
+                std::lock_guard<std::mutex> lock_guard(m_mutex);
+                ++m_inflight;
+            }
+            IoThreadPool::instance()->push(IoThreadPool::Job{this, fd, m_buffers[index], len, offset, index});
+        }
+
+        virtual size_t reap(Completion* done, size_t max, bool wait) override {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (wait) {
+                m_cond.wait(lock, [this]() {
+                    return !m_done.empty();
+                });
+            }
+            size_t count = 0;
+            while (!m_done.empty() && count < max) {
+                done[count++] = m_done.front();
+                m_done.pop_front();
+            }
+            return count;
+        }
+
+        virtual const char* name() const override {
+            return "threads";
+        }
+
+        /// @brief complete 写线程完成一个请求
+        void complete(unsigned index, ssize_t result) {
+            std::lock_guard<std::mutex> lock_guard(m_mutex);
+            m_done.push_back(Completion{index, result});
+            --m_inflight;
+            m_cond.notify_all();
+        }
+
+    private:
+        std::vector<char*> m_buffers;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::deque<Completion> m_done;
+        size_t m_inflight = 0;
+};
+
+constexpr int IoThreadPool::THREADS;
+
+void IoThreadPool::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cond.wait(lock, [this]() {
+            return !m_jobs.empty();
+        });
+        Job job = m_jobs.front();
+        m_jobs.pop_front();
+        lock.unlock();
+        ssize_t result = pwriteAll(job.fd, job.data, job.len, job.offset);
+        job.engine->complete(job.index, result);
+        lock.lock();
+    }
+}
+
+#ifdef DAQ_LOG_HAS_IO_URING
+void UringEngine::startFallback() {
+    std::vector<char*> buffers;
+    for (const struct iovec& iov : m_iovs) {
+        buffers.push_back(static_cast<char*>(iov.iov_base));
+    }
+    m_fallback.reset(new ThreadEngine(buffers));
+    //io_uring_enter失败时内核没有取走这些请求，退回提交队列的tail后重新提交
+    unsigned tail = *m_sqTail;
+    for (unsigned i = tail - m_toSubmit; i != tail; ++i) {
+        const struct io_uring_sqe& sqe = m_sqes[i & m_sqMask];
+        unsigned index = unsigned(sqe.user_data);
+        size_t len = m_fixed ? sqe.len : m_iovs[index].iov_len;
+        m_fallback->submit(sqe.fd, index, len, sqe.off);
+    }
+    __atomic_store_n(m_sqTail, tail - m_toSubmit, __ATOMIC_RELEASE);
+    m_toSubmit = 0;
+}
+
+size_t UringEngine::reapFallback(Completion* done, size_t max, bool wait) {
+    //内核中还有请求时不能阻塞在写线程池上，两边轮流检查
+    while (true) {
+        size_t count = m_fallback->reap(done, max, wait && m_inflight == 0);
+        count += peek(done + count, max - count);
+        if (count > 0 || !wait || m_inflight == 0) {
+            return count;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+#endif
+
+//IoEngine
+/*******************************************************************************/
+std::unique_ptr<IoEngine> IoEngine::create(const std::vector<char*>& buffers, size_t bufferSize) {
+#ifdef DAQ_LOG_HAS_IO_URING
+    std::unique_ptr<UringEngine> uring(new UringEngine());
+    if (uring->init(buffers, bufferSize)) {
+        return uring;
+    }
+#endif
+    return std::unique_ptr<IoEngine>(new ThreadEngine(buffers));
+}
+
+}
@@ -6,47 +6,49 @@ const char* const LocationInfo::NA = "??";
 const char* const LocationInfo::NA_METHOD = "??::??";
 
 const LocationInfo& LocationInfo::getLocationUnavailable() {
-    static const LocationInfo unavailable;
+    static const LocationInfo unavailable(NA, NA_METHOD, -1, LogLevel::TRACE, nullptr, true);
     return unavailable;
 }
 
-LocationInfo::LocationInfo(const char * const fileName,
-                           const char * const methodName,
-                           int lineNumber)
-    : m_lineNumber(lineNumber),
-      m_fileName(fileName),
-      m_methodName(methodName) {}
-
 LocationInfo::LocationInfo()
-    : m_lineNumber(-1),
-      m_fileName(LocationInfo::NA),
-      m_methodName(LocationInfo::NA_METHOD) {
+    : LocationInfo(LocationInfo::NA, LocationInfo::NA_METHOD, -1) {
 }
 
 LocationInfo::LocationInfo(const LocationInfo & rth)
     :  m_lineNumber(rth.m_lineNumber),
        m_fileName(rth.m_fileName),
-       m_methodName(rth.m_methodName) {
+       m_methodName(rth.m_methodName),
+       m_baseName(rth.m_baseName),
+       m_className(rth.m_className),
+       m_classLength(rth.m_classLength),
+       m_method(rth.m_method),
+       m_methodLength(rth.m_methodLength),
+       m_level(rth.m_level),
+       m_format(rth.m_format),
+       m_persistent(false) {
 }
 
 LocationInfo& LocationInfo::operator=(const LocationInfo& rth) {
     m_fileName = rth.m_fileName;
     m_methodName = rth.m_methodName;
     m_lineNumber = rth.m_lineNumber;
+    m_baseName = rth.m_baseName;
+    m_className = rth.m_className;
+    m_classLength = rth.m_classLength;
+    m_method = rth.m_method;
+    m_methodLength = rth.m_methodLength;
+    m_level = rth.m_level;
+    m_format = rth.m_format;
+    m_persistent = false;
     return *this;
 }
 
 LocationInfo& LocationInfo::operator=(const LocationInfo&& rth) {
-    m_fileName = rth.m_fileName;
-    m_methodName = rth.m_methodName;
-    m_lineNumber = rth.m_lineNumber;
-    return *this;
+    return *this = rth;
 }
 
 void LocationInfo::clear() {
-    m_fileName = NA;
-    m_methodName = NA_METHOD;
-    m_lineNumber = -1;
+    *this = LocationInfo();
 }
 
 
@@ -59,36 +61,11 @@ int LocationInfo::getLineNumber() const {
 }
 
 const std::string LocationInfo::getMethodName() const {
-    std::string tmp(m_methodName);
-    size_t colonPos = tmp.find("::");
-    if (colonPos != std::string::npos) {
-        tmp.erase(0, colonPos + 2);
-    } else {
-        size_t spacePos = tmp.find(' ');
-        if (spacePos != std::string::npos) {
-            tmp.erase(0, spacePos + 1);
-        }
-    }
-    //size_t parenPos = tmp.find('(');
-    //if (parenPos != std::string::npos) {
-    //    tmp.erase(parenPos);
-    //}
-    return tmp;
+    return std::string(m_method, m_methodLength);
 }
 
 const std::string LocationInfo::getClassName() const {
-    std::string tmp(m_methodName);
-    size_t colonPos = tmp.find("::");
-    if (colonPos != std::string::npos) {
-        tmp.erase(colonPos);
-        size_t spacePos = tmp.find_last_of(' ');
-        if (spacePos != std::string::npos) {
-            tmp.erase(0, spacePos + 1);
-        }
-        return tmp;
-    }
-    //tmp.erase(0, tmp.length());
-    return "??";
+    return std::string(m_className, m_classLength);
 }
 
 }
@@ -0,0 +1,142 @@
+#include <ctime>
+#include <thread>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#define DAQ_LOG_HAS_TSC 1
+#endif
+
+#include "logclock.hpp"
+
+namespace daq {
+
+static uint64_t clockNow(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+std::atomic<ClockSource> LogClock::s_source{ClockSource::REALTIME};
+
+//加载日志库时记录，用于%r
+static const uint64_t s_startTime = clockNow(CLOCK_REALTIME);
+
+uint64_t LogClock::getStartTime() {
+    return s_startTime;
+}
+
+uint64_t LogClock::now() {
+    switch (s_source.load(std::memory_order_relaxed)) {
+    case ClockSource::REALTIME_COARSE:
+        return clockNow(CLOCK_REALTIME_COARSE);
+    case ClockSource::TSC:
+        return tscNow();
+    default:
+        return clockNow(CLOCK_REALTIME);
+    }
+}
+
+#ifdef DAQ_LOG_HAS_TSC
+//TSC换算参数: ns = baseNs + ((tsc - baseTsc) * mult >> 32)，用seqlock更新
+static std::atomic<uint32_t> s_tscSeq{0};
+static std::atomic<uint64_t> s_baseTsc{0};
+static std::atomic<uint64_t> s_baseNs{0};
+static std::atomic<uint64_t> s_mult{0};
+static std::atomic<uint64_t> s_resyncTicks{0};
+//第一次校准的参考点，重新同步时用更长的区间修正mult
+static uint64_t s_calibTsc = 0;
+static uint64_t s_calibNs = 0;
+
+static bool hasInvariantTsc() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return edx & (1u << 8);
+}
+
+/// @brief tscResync 用REALTIME重新确定基准点，只由拿到seq的线程调用
+static void tscResync(uint32_t seq) {
+    //seq变为奇数之后才能写基准点
+    std::atomic_thread_fence(std::memory_order_release);
+    uint64_t tsc = __rdtsc();
+    uint64_t ns = clockNow(CLOCK_REALTIME);
+    if (tsc > s_calibTsc && ns > s_calibNs) {
+        unsigned __int128 mult = (unsigned __int128)(ns - s_calibNs) << 32;
+        s_mult.store(uint64_t(mult / (tsc - s_calibTsc)), std::memory_order_relaxed);
+    }
+    s_baseTsc.store(tsc, std::memory_order_relaxed);
+    s_baseNs.store(ns, std::memory_order_relaxed);
+    s_tscSeq.store(seq + 2, std::memory_order_release);
+}
+
+static bool tscCalibrate() {
+    if (!hasInvariantTsc()) {
+        return false;
+    }
+    uint64_t ns0 = clockNow(CLOCK_REALTIME);
+    uint64_t tsc0 = __rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    uint64_t ns1 = clockNow(CLOCK_REALTIME);
+    uint64_t tsc1 = __rdtsc();
+    if (tsc1 <= tsc0 || ns1 <= ns0) {
+        return false;
+    }
+
+    uint32_t seq = s_tscSeq.load(std::memory_order_relaxed);
+    while ((seq & 1) || !s_tscSeq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire)) {
+        seq = s_tscSeq.load(std::memory_order_relaxed);
+    }
+    s_calibTsc = tsc0;
+    s_calibNs = ns0;
+    //每秒大约需要的tick数，超过后重新同步
+    s_resyncTicks.store((tsc1 - tsc0) * 1000000000 / (ns1 - ns0), std::memory_order_relaxed);
+    tscResync(seq);
+    return true;
+}
+
+uint64_t LogClock::tscNow() {
+    while (true) {
+        uint32_t seq = s_tscSeq.load(std::memory_order_acquire);
+        uint64_t baseTsc = s_baseTsc.load(std::memory_order_relaxed);
+        uint64_t baseNs = s_baseNs.load(std::memory_order_relaxed);
+        uint64_t mult = s_mult.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((seq & 1) || s_tscSeq.load(std::memory_order_relaxed) != seq) {
+            continue;
+        }
+
+        uint64_t tsc = __rdtsc();
+        uint64_t delta = tsc > baseTsc ? tsc - baseTsc : 0;
+        //距上次同步超过1秒，抢到seq的线程负责重新同步，其余线程照常换算
+        if (delta > s_resyncTicks.load(std::memory_order_relaxed)
+                && s_tscSeq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) {
+            tscResync(seq);
+            continue;
+        }
+        return baseNs + uint64_t(((unsigned __int128)delta * mult) >> 32);
+    }
+}
+
+void LogClock::setSource(ClockSource source) {
+    if (source == ClockSource::TSC && !tscCalibrate()) {
+        source = ClockSource::REALTIME;
+    }
+    s_source.store(source, std::memory_order_relaxed);
+}
+#else
+uint64_t LogClock::tscNow() {
+    return clockNow(CLOCK_REALTIME);
+}
+
+void LogClock::setSource(ClockSource source) {
+    if (source == ClockSource::TSC) {
+        source = ClockSource::REALTIME;
+    }
+    s_source.store(source, std::memory_order_relaxed);
+}
+#endif
+
+}
@@ -0,0 +1,248 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include <zlib.h>
+#ifdef DAQ_LOG_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#include "logcompressor.hpp"
+
+namespace daq {
+
+static constexpr size_t CHUNK_SIZE = 256 * 1024;
+
+LogCompressor* LogCompressor::instance() {
+    static LogCompressor* compressor = new LogCompressor();
+    return compressor;
+}
+
+const char* LogCompressor::getSuffix(Compression compression) {
+    switch (compression) {
+    case Compression::GZIP:
+        return ".gz";
+    case Compression::ZSTD:
+#ifdef DAQ_LOG_HAS_ZSTD
+        return ".zst";
+#else
+        return ".gz";
+#endif
+    default:
+        return "";
+    }
+}
+
+void LogCompressor::submit(const std::string& path, Compression compression, Callback done) {
+    if (compression == Compression::NONE) {
+        if (done) {
+            done(path, path);
+        }
+        return;
+    }
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    push(Task{path, compression, std::move(done), nullptr});
+}
+
+void LogCompressor::post(std::function<void()> job) {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    push(Task{std::string(), Compression::NONE, nullptr, std::move(job)});
+}
+
+void LogCompressor::push(Task&& task) {
+    m_tasks.push_back(std::move(task));
+    if (m_idle == 0 && m_threads < m_maxThreads) {
+        ++m_threads;
+        std::thread(&LogCompressor::run, this).detach();
+    } else {
+        m_cond.notify_one();
+    }
+}
+
+void LogCompressor::setMaxThreads(size_t count) {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    m_maxThreads = count == 0 ? 1 : count;
+    //多余的线程在空闲时退出
+    m_cond.notify_all();
+}
+
+size_t LogCompressor::pending() {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    return m_tasks.size() + m_running;
+}
+
+void LogCompressor::run() {
+    //最低的CPU和IO优先级，只影响本线程
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);
+#ifdef SYS_ioprio_set
+    const int IOPRIO_WHO_PROCESS = 1;
+    const int IOPRIO_CLASS_IDLE = 3;
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << 13);
+#endif
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        if (m_threads > m_maxThreads) {
+            --m_threads;
+            return;
+        }
+        if (m_tasks.empty()) {
+            ++m_idle;
+            m_cond.wait(lock);
+            --m_idle;
+            continue;
+        }
+        Task task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        ++m_running;
+        lock.unlock();
+
+        if (task.job) {
+            task.job();
+        } else {
+            std::string target = compress(task.path, task.compression);
+            if (task.done) {
+                task.done(task.path, target.empty() ? task.path : target);
+            }
+        }
+
+        lock.lock();
+        --m_running;
+    }
+}
+
+static bool gzipFile(int in, int out) {
+    int fd = dup(out);
+    gzFile gz = fd < 0 ? nullptr : gzdopen(fd, "wb6");
+    if (gz == nullptr) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    gzbuffer(gz, CHUNK_SIZE);
+    std::vector<char> buffer(CHUNK_SIZE);
+    bool ok = true;
+    while (ok) {
+        ssize_t n = ::read(in, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        ok = gzwrite(gz, buffer.data(), n) == n;
+    }
+    return gzclose(gz) == Z_OK && ok;
+}
+
+#ifdef DAQ_LOG_HAS_ZSTD
+static bool writeFd(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool zstdFile(int in, int out) {
+    ZSTD_CCtx* cctx = ZSTD_createCCtx();
+    if (cctx == nullptr) {
+        return false;
+    }
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, 3);
+    std::vector<char> input(CHUNK_SIZE);
+    std::vector<char> output(ZSTD_CStreamOutSize());
+    bool ok = true;
+    while (ok) {
+        ssize_t n = ::read(in, input.data(), input.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            ok = false;
+            break;
+        }
+        ZSTD_EndDirective mode = n == 0 ? ZSTD_e_end : ZSTD_e_continue;
+        ZSTD_inBuffer inBuffer = {input.data(), size_t(n), 0};
+        bool finished = false;
+        while (ok && !finished) {
+            ZSTD_outBuffer outBuffer = {output.data(), output.size(), 0};
+            size_t remaining = ZSTD_compressStream2(cctx, &outBuffer, &inBuffer, mode);
+            ok = !ZSTD_isError(remaining) && writeFd(out, output.data(), outBuffer.pos);
+            finished = mode == ZSTD_e_end ? remaining == 0 : inBuffer.pos == inBuffer.size;
+        }
+        if (n == 0) {
+            break;
+        }
+    }
+    ZSTD_freeCCtx(cctx);
+    return ok;
+}
+#endif
+
+//同步文件所在的目录，使目录项的修改落盘
+static void syncDir(const std::string& path) {
+    size_t pos = path.rfind('/');
+    std::string dir = pos == std::string::npos ? "." : pos == 0 ? "/" : path.substr(0, pos);
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    if (fsync(fd) != 0) {
+        std::cout << "LogCompressor fsync " << dir << " error: " << strerror(errno) << std::endl;
+    }
+    ::close(fd);
+}
+
+std::string LogCompressor::compress(const std::string& path, Compression compression) {
+    std::string target = path + getSuffix(compression);
+    std::string temp = target + ".tmp";
+    int in = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        std::cout << "LogCompressor open " << path << " error: " << strerror(errno) << std::endl;
+        return "";
+    }
+    int out = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        std::cout << "LogCompressor open " << temp << " error: " << strerror(errno) << std::endl;
+        ::close(in);
+        return "";
+    }
+
+#ifdef DAQ_LOG_HAS_ZSTD
+    bool ok = compression == Compression::ZSTD ? zstdFile(in, out) : gzipFile(in, out);
+#else
+    bool ok = gzipFile(in, out);
+#endif
+    //落盘后才替换，删除原文件前保证压缩文件完整
+    ok = ok && fsync(out) == 0;
+    ::close(out);
+    ::close(in);
+    if (!ok || rename(temp.c_str(), target.c_str()) != 0) {
+        std::cout << "LogCompressor compress " << path << " failed" << std::endl;
+        unlink(temp.c_str());
+        return "";
+    }
+    //rename落盘后才删除原文件，掉电时不会两个文件都丢失
+    syncDir(path);
+    unlink(path.c_str());
+    return target;
+}
+
+}
@@ -70,6 +70,92 @@ std::vector<log_config_t> LogConfigurator::readJsonFromFile(const std::string& f
             conf.port = value["loggers"][i]["port"].asInt();
             conf.rollFileSize = value["loggers"][i]["rollFileSize"].asInt();
             conf.asyncBufferSize = value["loggers"][i]["bufferSize"].asInt();
+            if (value["loggers"][i].isMember("waitStrategy")) {
+                conf.waitStrategy = WaitStrategy(value["loggers"][i]["waitStrategy"].asInt());
+            }
+            conf.deferredFormat = value["loggers"][i]["deferredFormat"].asBool();
+            if (value["loggers"][i].isMember("flushBufferSize")) {
+                conf.flushPolicy.bufferSize = value["loggers"][i]["flushBufferSize"].asUInt();
+            }
+            if (value["loggers"][i].isMember("flushInterval")) {
+                conf.flushPolicy.intervalMs = value["loggers"][i]["flushInterval"].asUInt();
+            }
+            if (value["loggers"][i].isMember("flushLevel")) {
+                conf.flushPolicy.level = LogLevel(value["loggers"][i]["flushLevel"].asInt());
+            }
+            if (value["loggers"][i].isMember("asyncWrite")) {
+                conf.flushPolicy.asyncDepth = value["loggers"][i]["asyncWrite"].asUInt();
+            }
+            conf.flushPolicy.directIo = value["loggers"][i]["directIo"].asBool();
+            conf.flushPolicy.preallocate = value["loggers"][i]["preallocate"].asBool();
+            if (value["loggers"][i].isMember("rollPeriod")) {
+                conf.rollPeriod = RollPeriod(value["loggers"][i]["rollPeriod"].asInt());
+            }
+            if (value["loggers"][i].isMember("retainFiles")) {
+                conf.retention.maxFiles = value["loggers"][i]["retainFiles"].asUInt();
+            }
+            if (value["loggers"][i].isMember("retainSize")) {
+                conf.retention.maxBytes = value["loggers"][i]["retainSize"].asUInt64() * 1024 * 1024;
+            }
+            if (value["loggers"][i].isMember("retainAge")) {
+                conf.retention.maxAgeSec = value["loggers"][i]["retainAge"].asUInt();
+            }
+            if (value["loggers"][i].isMember("compression")) {
+                conf.compression = Compression(value["loggers"][i]["compression"].asInt());
+            }
+            if (value["loggers"][i].isMember("httpBatchEvents")) {
+                conf.httpBatch.maxEvents = value["loggers"][i]["httpBatchEvents"].asUInt();
+            }
+            if (value["loggers"][i].isMember("httpBatchBytes")) {
+                conf.httpBatch.maxBytes = value["loggers"][i]["httpBatchBytes"].asUInt();
+            }
+            if (value["loggers"][i].isMember("httpBatchAge")) {
+                conf.httpBatch.maxAgeMs = value["loggers"][i]["httpBatchAge"].asUInt();
+            }
+            conf.httpBatch.gzip = value["loggers"][i]["httpGzip"].asBool();
+            if (value["loggers"][i].isMember("httpInflight")) {
+                conf.httpSend.maxInflight = value["loggers"][i]["httpInflight"].asUInt();
+            }
+            if (value["loggers"][i].isMember("httpBacklog")) {
+                conf.httpSend.maxBacklog = value["loggers"][i]["httpBacklog"].asUInt64();
+            }
+            if (value["loggers"][i].isMember("httpTimeout")) {
+                conf.httpSend.timeoutMs = value["loggers"][i]["httpTimeout"].asUInt();
+            }
+            if (value["loggers"][i].isMember("httpRetryMax")) {
+                conf.httpSend.retryMaxMs = value["loggers"][i]["httpRetryMax"].asUInt();
+            }
+            if (value["loggers"][i].isMember("httpSpoolInflight")) {
+                conf.httpSend.spoolInflight = value["loggers"][i]["httpSpoolInflight"].asUInt();
+            }
+            conf.spool.dir = value["loggers"][i]["spoolDir"].asString();
+            if (value["loggers"][i].isMember("spoolSize")) {
+                conf.spool.maxBytes = value["loggers"][i]["spoolSize"].asUInt64() * 1024 * 1024;
+            }
+            if (value["loggers"][i].isMember("spoolSegmentSize")) {
+                conf.spool.segmentBytes = value["loggers"][i]["spoolSegmentSize"].asUInt64() * 1024 * 1024;
+            }
+            if (value["loggers"][i].isMember("spoolDrainRate")) {
+                conf.spool.drainRate = value["loggers"][i]["spoolDrainRate"].asUInt64() * 1024;
+            }
+            if (value["loggers"][i].isMember("zmqBatchEvents")) {
+                conf.zmqSend.maxEvents = value["loggers"][i]["zmqBatchEvents"].asUInt();
+            }
+            if (value["loggers"][i].isMember("zmqBatchBytes")) {
+                conf.zmqSend.maxBytes = value["loggers"][i]["zmqBatchBytes"].asUInt();
+            }
+            if (value["loggers"][i].isMember("zmqBatchAge")) {
+                conf.zmqSend.maxAgeMs = value["loggers"][i]["zmqBatchAge"].asUInt();
+            }
+            if (value["loggers"][i].isMember("zmqHwm")) {
+                conf.zmqSend.sndhwm = value["loggers"][i]["zmqHwm"].asInt();
+            }
+            if (value["loggers"][i].isMember("zmqLinger")) {
+                conf.zmqSend.linger = value["loggers"][i]["zmqLinger"].asInt();
+            }
+            if (value["loggers"][i].isMember("zmqSendTimeout")) {
+                conf.zmqSend.sndtimeoMs = value["loggers"][i]["zmqSendTimeout"].asInt();
+            }
             confs.push_back(conf);
         }
         in.close();
@@ -139,6 +225,134 @@ std::vector<log_config_t> LogConfigurator::readXMLFromFile(const std::string& fi
             if (ele) {
                 conf.asyncBufferSize = std::stol(ele->GetText());
             }
+            ele = logger->FirstChildElement("waitStrategy");
+            if (ele) {
+                conf.waitStrategy = WaitStrategy(std::stoul(ele->GetText()));
+            }
+            ele = logger->FirstChildElement("deferredFormat");
+            if (ele) {
+                conf.deferredFormat = std::stoul(ele->GetText()) != 0;
+            }
+            ele = logger->FirstChildElement("flushBufferSize");
+            if (ele) {
+                conf.flushPolicy.bufferSize = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("flushInterval");
+            if (ele) {
+                conf.flushPolicy.intervalMs = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("flushLevel");
+            if (ele) {
+                conf.flushPolicy.level = LogLevel(std::stoul(ele->GetText()));
+            }
+            ele = logger->FirstChildElement("asyncWrite");
+            if (ele) {
+                conf.flushPolicy.asyncDepth = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("directIo");
+            if (ele) {
+                conf.flushPolicy.directIo = std::stoul(ele->GetText()) != 0;
+            }
+            ele = logger->FirstChildElement("preallocate");
+            if (ele) {
+                conf.flushPolicy.preallocate = std::stoul(ele->GetText()) != 0;
+            }
+            ele = logger->FirstChildElement("rollPeriod");
+            if (ele) {
+                conf.rollPeriod = RollPeriod(std::stoul(ele->GetText()));
+            }
+            ele = logger->FirstChildElement("retainFiles");
+            if (ele) {
+                conf.retention.maxFiles = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("retainSize");
+            if (ele) {
+                conf.retention.maxBytes = std::stoull(ele->GetText()) * 1024 * 1024;
+            }
+            ele = logger->FirstChildElement("retainAge");
+            if (ele) {
+                conf.retention.maxAgeSec = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("compression");
+            if (ele) {
+                conf.compression = Compression(std::stoul(ele->GetText()));
+            }
+            ele = logger->FirstChildElement("httpBatchEvents");
+            if (ele) {
+                conf.httpBatch.maxEvents = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("httpBatchBytes");
+            if (ele) {
+                conf.httpBatch.maxBytes = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("httpBatchAge");
+            if (ele) {
+                conf.httpBatch.maxAgeMs = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("httpGzip");
+            if (ele) {
+                conf.httpBatch.gzip = std::stoul(ele->GetText()) != 0;
+            }
+            ele = logger->FirstChildElement("httpInflight");
+            if (ele) {
+                conf.httpSend.maxInflight = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("httpBacklog");
+            if (ele) {
+                conf.httpSend.maxBacklog = std::stoull(ele->GetText());
+            }
+            ele = logger->FirstChildElement("httpTimeout");
+            if (ele) {
+                conf.httpSend.timeoutMs = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("httpRetryMax");
+            if (ele) {
+                conf.httpSend.retryMaxMs = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("httpSpoolInflight");
+            if (ele) {
+                conf.httpSend.spoolInflight = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("spoolDir");
+            if (ele) {
+                conf.spool.dir = ele->GetText();
+            }
+            ele = logger->FirstChildElement("spoolSize");
+            if (ele) {
+                conf.spool.maxBytes = std::stoull(ele->GetText()) * 1024 * 1024;
+            }
+            ele = logger->FirstChildElement("spoolSegmentSize");
+            if (ele) {
+                conf.spool.segmentBytes = std::stoull(ele->GetText()) * 1024 * 1024;
+            }
+            ele = logger->FirstChildElement("spoolDrainRate");
+            if (ele) {
+                conf.spool.drainRate = std::stoull(ele->GetText()) * 1024;
+            }
+            ele = logger->FirstChildElement("zmqBatchEvents");
+            if (ele) {
+                conf.zmqSend.maxEvents = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("zmqBatchBytes");
+            if (ele) {
+                conf.zmqSend.maxBytes = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("zmqBatchAge");
+            if (ele) {
+                conf.zmqSend.maxAgeMs = std::stoul(ele->GetText());
+            }
+            ele = logger->FirstChildElement("zmqHwm");
+            if (ele) {
+                conf.zmqSend.sndhwm = std::stoi(ele->GetText());
+            }
+            ele = logger->FirstChildElement("zmqLinger");
+            if (ele) {
+                conf.zmqSend.linger = std::stoi(ele->GetText());
+            }
+            ele = logger->FirstChildElement("zmqSendTimeout");
+            if (ele) {
+                conf.zmqSend.sndtimeoMs = std::stoi(ele->GetText());
+            }
 
             ///获取Appenders,可能不止一个
             const XMLElement* appenders = logger->FirstChildElement("appenders");
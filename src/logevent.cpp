@@ -1,13 +1,199 @@
+#include <cstring>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <boost/fiber/context.hpp>
+
 #include "logevent.hpp"
 
 namespace daq {
 
+std::atomic<bool> LogEvent::s_captureFiber{false};
+
+//线程id和线程名，0表示还没有取过
+static thread_local uint32_t t_threadId = 0;
+static thread_local char t_threadName[16] = {0};
+
+//fork后子进程中的线程id会变，清空缓存
+static void resetThreadCache() {
+    t_threadId = 0;
+    t_threadName[0] = '\0';
+}
+
+static const int s_atforkRegistered = pthread_atfork(nullptr, nullptr, resetThreadCache);
+
+uint32_t LogEvent::currentThreadId() {
+    if (!t_threadId) {
+        t_threadId = uint32_t(syscall(__NR_gettid));
+    }
+    return t_threadId;
+}
+
+const char* LogEvent::currentThreadName() {
+    if (!t_threadName[0]) {
+        if (pthread_getname_np(pthread_self(), t_threadName, sizeof(t_threadName)) != 0
+                || !t_threadName[0]) {
+            strncpy(t_threadName, "??", sizeof(t_threadName));
+        }
+    }
+    return t_threadName;
+}
+
+void LogEvent::setCurrentThreadName(const std::string& name) {
+    strncpy(t_threadName, name.c_str(), sizeof(t_threadName) - 1);
+    t_threadName[sizeof(t_threadName) - 1] = '\0';
+    pthread_setname_np(pthread_self(), t_threadName);
+}
+
+std::string LogEvent::getFiberId() const {
+    if (!m_fiber) {
+        return "{not-valid}";
+    }
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%p", m_fiber);
+    return buffer;
+}
+
 LogEvent::LogEvent() {}
 LogEvent::LogEvent(const std::string& loggerName, LogLevel level,
                    const std::string& msg, const LocationInfo& locationInfo)
     : m_loggerName(loggerName),
       m_level(level),
-      m_content(msg),
-      m_locationInfo(locationInfo) {}
+      m_timestamp(LogClock::now()),
+      m_threadId(currentThreadId()),
+      m_content(msg) {
+    setLocationInfo(locationInfo);
+    memcpy(m_threadName, currentThreadName(), sizeof(m_threadName));
+    if (s_captureFiber.load(std::memory_order_relaxed)) {
+        m_fiber = boost::fibers::context::active();
+    }
+}
+
+LogEvent::sptr LogEvent::create(const std::string& loggerName, LogLevel level,
+                                const std::string& msg, const LocationInfo& locationInfo) {
+    sptr event = create(loggerName, level, locationInfo);
+    //assign复用字符串已有的容量
+    event->m_content.assign(msg);
+    return event;
+}
+
+LogEvent::sptr LogEvent::create(const std::string& loggerName, LogLevel level,
+                                const LocationInfo& locationInfo) {
+    LogEvent* event = LogEventPool::local()->acquire();
+    event->m_loggerName.assign(loggerName);
+    event->m_level = level;
+    event->m_timestamp = LogClock::now();
+    event->m_threadId = currentThreadId();
+    memcpy(event->m_threadName, currentThreadName(), sizeof(event->m_threadName));
+    event->m_fiber = s_captureFiber.load(std::memory_order_relaxed)
+                     ? boost::fibers::context::active() : nullptr;
+    event->m_content.clear();
+    event->m_args.clear();
+    event->m_argsDecoder = nullptr;
+    event->setLocationInfo(locationInfo);
+    return sptr(event);
+}
+
+void LogEvent::recycle(LogEvent* event) {
+    if (event->m_pool) {
+        event->m_pool->release(event);
+    } else {
+        delete event;
+    }
+}
+
+//LogEventPool
+/*******************************************************************************/
+//当前线程的池，线程退出时置空，之后归还的事件走远端链表
+static thread_local LogEventPool* t_currentPool = nullptr;
+
+struct LogEventPoolHolder {
+    LogEventPool* pool = new LogEventPool;
+    LogEventPoolHolder() {
+        t_currentPool = pool;
+    }
+    ~LogEventPoolHolder() {
+        t_currentPool = nullptr;
+        pool->unref();
+    }
+};
+
+LogEventPool* LogEventPool::local() {
+    static thread_local LogEventPoolHolder holder;
+    return holder.pool;
+}
+
+constexpr size_t LogEventPool::MAX_FREE;
+constexpr size_t LogEventPool::MAX_KEPT_CAPACITY;
+
+//超过容量上限的字符串换成空串，释放内存
+static void trimString(std::string& str) {
+    if (str.capacity() > LogEventPool::MAX_KEPT_CAPACITY) {
+        std::string().swap(str);
+    }
+}
+
+LogEvent* LogEventPool::acquire() {
+    LogEvent* event = m_localHead;
+    if (!event) {
+        event = m_remoteHead.exchange(nullptr, std::memory_order_acquire);
+        m_localCount = m_remoteCount.exchange(0, std::memory_order_relaxed);
+    }
+    if (event) {
+        m_localHead = event->m_next;
+        event->m_next = nullptr;
+        if (m_localCount > 0) {
+            --m_localCount;
+        }
+    } else {
+        event = new LogEvent;
+        event->m_pool = this;
+    }
+    m_refCount.fetch_add(1, std::memory_order_relaxed);
+    return event;
+}
+
+void LogEventPool::release(LogEvent* event) {
+    trimString(event->m_content);
+    trimString(event->m_args);
+    trimString(event->m_loggerName);
+    if (this == t_currentPool) {
+        if (m_localCount >= MAX_FREE) {
+            delete event;
+        } else {
+            event->m_next = m_localHead;
+            m_localHead = event;
+            ++m_localCount;
+        }
+    } else if (m_remoteCount.load(std::memory_order_relaxed) >= MAX_FREE) {
+        delete event;
+    } else {
+        m_remoteCount.fetch_add(1, std::memory_order_relaxed);
+        LogEvent* head = m_remoteHead.load(std::memory_order_relaxed);
+        do {
+            event->m_next = head;
+        } while (!m_remoteHead.compare_exchange_weak(head, event,
+                 std::memory_order_release, std::memory_order_relaxed));
+    }
+    unref();
+}
+
+void LogEventPool::unref() {
+    if (m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+LogEventPool::~LogEventPool() {
+    LogEvent* lists[] = {m_localHead, m_remoteHead.load(std::memory_order_acquire)};
+    for (LogEvent* event : lists) {
+        while (event) {
+            LogEvent* next = event->m_next;
+            delete event;
+            event = next;
+        }
+    }
+}
 
 }
@@ -2,142 +2,155 @@
 
 namespace daq {
 
-void Logger::log(LogLevel level, const std::string& msg) {
-    if (level >= m_conf.outputLevel) {
-        auto self(shared_from_this());
-        LogEvent::sptr event(new LogEvent(self->getName(), level, msg, LocationInfo::getLocationUnavailable()));
-        for(auto it = m_appendersMap.begin() ; it != m_appendersMap.end(); ++it) {
-            it->second->append(event);
+void Logger::log(LogEvent::sptr event) {
+    m_appenders.read([&event](const std::vector<Appender*>& appenders) {
+        for (Appender* appender : appenders) {
+            appender->append(event);
         }
-    }
+    });
 }
 
-void Logger::log(LogLevel level, const std::string& msg, const LocationInfo& location) {
-    if (level >= m_conf.outputLevel) {
-        auto self(shared_from_this());
-        LogEvent::sptr event(new LogEvent(self->getName(), level, msg, location));
-        for(auto it = m_appendersMap.begin(); it != m_appendersMap.end(); ++it) {
-            it->second->append(event);
-        }
+void Logger::log(LogLevel level, const std::string& msg) {
+    if (isEnabled(level)) {
+        Logger::log(LogEvent::sptr(LogEvent::create(m_conf.loggerName, level, msg, LocationInfo::getLocationUnavailable())));
     }
 }
 
-void Logger::trace(const std::string& msg, const LocationInfo& location) {
-    log(LogLevel::TRACE, msg, location);
-}
-
-void Logger::trace(const std::string& msg) {
-    log(LogLevel::TRACE, msg);
-}
-
-void Logger::debug(const std::string& msg, const LocationInfo& location) {
-    log(LogLevel::DEBUG, msg, location);
-}
-
-void Logger::debug(const std::string& msg) {
-    log(LogLevel::DEBUG, msg);
-}
-
-void Logger::info(const std::string& msg, const LocationInfo& location) {
-    log(LogLevel::INFO, msg, location);
-}
-
-void Logger::info(const std::string& msg) {
-    log(LogLevel::INFO, msg);
-}
-
-void Logger::warn(const std::string& msg, const LocationInfo& location) {
-    log(LogLevel::WARN, msg, location);
-}
-
-void Logger::warn(const std::string& msg) {
-    log(LogLevel::WARN, msg);
-}
-
-void Logger::error(const std::string& msg, const LocationInfo& location) {
-    log(LogLevel::ERROR, msg, location);
-}
-
-void Logger::error(const std::string& msg) {
-    log(LogLevel::ERROR, msg);
-}
-
-void Logger::fatal(const std::string& msg, const LocationInfo& location) {
-    log(LogLevel::FATAL, msg, location);
-}
-
-void Logger::fatal(const std::string& msg) {
-    log(LogLevel::FATAL, msg);
+void Logger::log(LogLevel level, const std::string& msg, const LocationInfo& location) {
+    if (isEnabled(level)) {
+        Logger::log(LogEvent::sptr(LogEvent::create(m_conf.loggerName, level, msg, location)));
+    }
 }
 
 void Logger::addAppender(Appender* appender) {
     std::lock_guard<std::mutex> lock_guard(m_mutex);
     std::string id = appender->getId();
-    auto it = m_appendersMap.find(id);
-    if (it == m_appendersMap.end()) {
-        if (!appender->hasFormatter()) {
-            if (id.find("HTTPAppender") != std::string::npos) {
-                appender->setFormatter(m_jsonFormatter);
-            } else {
-                appender->setFormatter(m_formatter);
-            }
+    if (!appender->hasFormatter()) {
+        if (id.find("HTTPAppender") != std::string::npos) {
+            appender->setFormatter(m_jsonFormatter);
+        } else {
+            appender->setFormatter(m_formatter);
         }
-        m_appendersMap[id] = appender;
     }
+    m_appenders.add(id, appender);
 }
 
 void Logger::delAppender(Appender* appender) {
     std::lock_guard<std::mutex> lock_guard(m_mutex);
-    std::string id = appender->getId();
-    auto it = m_appendersMap.find(id);
-    if (it != m_appendersMap.end()) {
-        delete it->second;
-        m_appendersMap.erase(it);
-    }
+    delete m_appenders.remove(appender->getId());
 }
 
 void Logger::clearAppender() {
     std::lock_guard<std::mutex> lock_guard(m_mutex);
-    for (auto e : m_appendersMap) {
-        delete e.second;
+    for (Appender* appender : m_appenders.clear()) {
+        delete appender;
     }
-    m_appendersMap.clear();
 }
 
 //AsLogger
 /*******************************************************************************/
-void AsLogger::pullEvent(moodycamel::ConcurrentQueue<LogEvent::sptr>& buffer,
-                         std::map<std::string, Appender*>& appenders) {
-    std::thread t([&]() {
-        LogEvent::sptr event;
-        while(true) {
-            if(buffer.try_dequeue(event)) {
-                for (auto it = appenders.begin(); it != appenders.end(); ++it) {
-                    it->second->append(event);
-                }
-            }
-        }
-    });
+constexpr size_t AsLogger::BATCH_SIZE;
+constexpr size_t AsLogger::SPIN_ROUNDS;
+constexpr size_t AsLogger::YIELD_ROUNDS;
+
+void AsLogger::startWorker() {
+    m_running.store(true);
     try {
-        t.detach();
+        m_worker = std::thread(&AsLogger::pullEvent, this);
     } catch(const std::system_error& e) {
+        m_running.store(false);
         std::cout << e.what() << "\n" << std::endl;
     }
 }
 
+void AsLogger::stopWorker() {
+    if (!m_worker.joinable()) {
+        return;
+    }
+    m_running.store(false);
+    {
+        std::lock_guard<std::mutex> lock_guard(m_sleepMutex);
+        m_sleepCond.notify_one();
+    }
+    m_worker.join();
+}
+
+void AsLogger::pullEvent() {
+    std::vector<LogEvent::sptr> batch(BATCH_SIZE);
+    size_t idleRounds = 0;
+    while (true) {
+        size_t count = m_buffer.try_dequeue_bulk(batch.begin(), BATCH_SIZE);
+        if (count == 0) {
+            //停止前已经把队列取空
+            if (!m_running.load()) {
+                break;
+            }
+            waitForEvent(idleRounds++);
+            continue;
+        }
+        idleRounds = 0;
+        //整批日志只进入一次读临界区
+        m_appenders.read([&batch, count](const std::vector<Appender*>& appenders) {
+            for (size_t i = 0; i < count; ++i) {
+                batch[i]->renderContent();
+                for (Appender* appender : appenders) {
+                    appender->append(batch[i]);
+                }
+                batch[i].reset();
+            }
+        });
+    }
+}
+
+void AsLogger::waitForEvent(size_t idleRounds) {
+    WaitStrategy strategy = m_waitStrategy.load(std::memory_order_relaxed);
+    if (strategy == WaitStrategy::SPIN || idleRounds < SPIN_ROUNDS) {
+        return;
+    }
+    if (strategy == WaitStrategy::YIELD || idleRounds < SPIN_ROUNDS + YIELD_ROUNDS) {
+        std::this_thread::yield();
+        return;
+    }
+
+    //先声明将要挂起，再检查一次队列，和notifyWorker配合避免丢失唤醒
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_sleeping.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_buffer.size_approx() == 0 && m_running.load()) {
+        m_sleepCond.wait_for(lock, std::chrono::milliseconds(100));
+    }
+    m_sleeping.store(false);
+}
+
+void AsLogger::notifyWorker() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock_guard(m_sleepMutex);
+        m_sleepCond.notify_one();
+    }
+}
+
+void AsLogger::pushEvent(LogEvent::sptr&& event) {
+    if (m_buffer.try_enqueue(std::move(event))) {
+        notifyWorker();
+    }
+}
+
+void AsLogger::log(LogEvent::sptr event) {
+    pushEvent(std::move(event));
+}
+
 void AsLogger::log(LogLevel level, const std::string & msg) {
-    if (level >= m_conf.outputLevel) {
-        auto self(std::dynamic_pointer_cast<AsLogger>(shared_from_this()));
-        LogEvent::sptr event(new LogEvent(self->getName(), level, msg, LocationInfo::getLocationUnavailable()));
-        m_buffer.try_enqueue(event);
+    if (isEnabled(level)) {
+        LogEvent::sptr event(LogEvent::create(m_conf.loggerName, level, msg, LocationInfo::getLocationUnavailable()));
+        pushEvent(std::move(event));
     }
 }
 
 void AsLogger::log(LogLevel level, const std::string & msg, const LocationInfo & location) {
-    if (level >= m_conf.outputLevel) {
-        auto self(std::dynamic_pointer_cast<AsLogger>(shared_from_this()));
-        LogEvent::sptr event(new LogEvent(self->getName(), level, msg, location));
-        m_buffer.try_enqueue(event);
+    if (isEnabled(level)) {
+        LogEvent::sptr event(LogEvent::create(m_conf.loggerName, level, msg, location));
+        pushEvent(std::move(event));
     }
 }
 
@@ -3,16 +3,34 @@
 
 namespace daq {
 
+//按配置创建文件appender，LoggerFactory和AsLoggerFactory共用
+static Appender* createRollFileAppender(const log_config_t& conf) {
+    RollFileAppender* appender = new RollFileAppender(conf.rollFilePath.empty() ? "." : conf.rollFilePath,
+                                                      conf.rollFileSize ? conf.rollFileSize : 8,
+                                                      conf.rollFilePrefix, conf.rollFileSubfix, conf.flushPolicy);
+    appender->setRollPeriod(conf.rollPeriod);
+    appender->setRetention(conf.retention);
+    appender->setCompression(conf.compression);
+    return appender;
+}
+
+static Appender* createMmapFileAppender(const log_config_t& conf) {
+    MmapFileAppender* appender = new MmapFileAppender(conf.rollFilePath.empty() ? "." : conf.rollFilePath,
+                                                      conf.rollFileSize ? conf.rollFileSize : 64,
+                                                      conf.rollFilePrefix, conf.rollFileSubfix,
+                                                      conf.flushPolicy.intervalMs);
+    appender->setRetention(conf.retention);
+    return appender;
+}
+
 //LoggerFactory
 /*******************************************************************************/
 LoggerFactory* LoggerFactory::m_factory = nullptr;
 
 LoggerFactory* LoggerFactory::instance() {
-    static std::once_flag oc;
-    std::call_once(oc, [&]() {
-        m_factory = new LoggerFactory();
-    });
-    return m_factory;
+    //局部静态变量的初始化是线程安全的，之后每次调用只检查一次guard，比call_once便宜
+    static LoggerFactory* factory = m_factory = new LoggerFactory();
+    return factory;
 }
 
 LoggerFactory::LoggerFactory() {}
@@ -22,6 +40,7 @@ LoggerFactory::~LoggerFactory() {
 }
 
 std::list<std::string> LoggerFactory::getAllLoggerName() {
+    std::lock_guard<std::mutex> lock(m_mutex);
     std::list<std::string> list;
     for (auto logger : m_loggers) {
         list.push_back(logger.first);
@@ -42,13 +61,16 @@ void LoggerFactory::initFromFile(const std::string& filename) {
             if(str == "StdoutAppender") {
                 pLogger->addAppender(new StdoutAppender());
             } else if(str == "RollFileAppender") {
-                pLogger->addAppender(new RollFileAppender());
+                pLogger->addAppender(createRollFileAppender(conf));
             } else if(str == "SingleFileAppender") {
-                pLogger->addAppender(new SingleFileAppender(conf.singleFileName));
+                pLogger->addAppender(new SingleFileAppender(conf.singleFileName, conf.flushPolicy));
+            } else if(str == "MmapFileAppender") {
+                pLogger->addAppender(createMmapFileAppender(conf));
             } else if(str == "ZMQAppender") {
-                pLogger->addAppender(new ZMQAppender(conf.inetAddr, std::to_string(conf.port)));
+                pLogger->addAppender(new ZMQAppender(conf.inetAddr, std::to_string(conf.port),
+                                                     conf.zmqSend, conf.spool));
             } else if(str == "HTTPAppender") {
-                pLogger->addAppender(new HTTPAppender(conf.inetAddr, conf.port));
+                pLogger->addAppender(new HTTPAppender(conf.inetAddr, conf.port, conf.httpBatch, conf.httpSend, conf.spool));
             }
         }
     }
@@ -61,6 +83,8 @@ Logger::sptr LoggerFactory::initialize(const std::string& name, const LogLevel l
     if(!pLogger) {
         pLogger = std::make_shared<Logger>(name, level);
         m_loggers[name] = pLogger;
+        //默认logger是名字最小的logger
+        m_defaultLogger.store(m_loggers.begin()->second.get(), std::memory_order_release);
     }
 
     return pLogger;
@@ -71,11 +95,9 @@ Logger::sptr LoggerFactory::initialize(const std::string& name, const LogLevel l
 AsLoggerFactory* AsLoggerFactory::m_factory = nullptr;
 
 AsLoggerFactory* AsLoggerFactory::instance() {
-    static std::once_flag oc;
-    std::call_once(oc, [&]() {
-        m_factory = new AsLoggerFactory();
-    });
-    return m_factory;
+    //局部静态变量的初始化是线程安全的，之后每次调用只检查一次guard，比call_once便宜
+    static AsLoggerFactory* factory = m_factory = new AsLoggerFactory();
+    return factory;
 }
 
 AsLoggerFactory::AsLoggerFactory() {
@@ -86,6 +108,7 @@ AsLoggerFactory::~AsLoggerFactory() {
 }
 
 std::list<std::string> AsLoggerFactory::getAllLoggerName() {
+    std::lock_guard<std::mutex> lock(m_mutex);
     std::list<std::string> list;
     for (auto AsLogger : m_loggers) {
         list.push_back(AsLogger.first);
@@ -100,18 +123,23 @@ void AsLoggerFactory::initFromFile(const std::string& filename) {
 
     for (auto conf : confs) {
         AsLogger::sptr pAsLogger = initialize(conf.loggerName, conf.outputLevel, conf.asyncBufferSize);
+        pAsLogger->setWaitStrategy(conf.waitStrategy);
+        pAsLogger->setDeferredFormat(conf.deferredFormat);
         for(std::string str : conf.appenders) {
             if(str == "StdoutAppender") {
                 pAsLogger->addAppender(new StdoutAppender());
             } else if(str == "RollFileAppender") {
-                pAsLogger->addAppender(new RollFileAppender());
+                pAsLogger->addAppender(createRollFileAppender(conf));
             } else if(str == "SingleFileAppender") {
-                pAsLogger->addAppender(new SingleFileAppender(conf.singleFileName));
+                pAsLogger->addAppender(new SingleFileAppender(conf.singleFileName, conf.flushPolicy));
+            } else if(str == "MmapFileAppender") {
+                pAsLogger->addAppender(createMmapFileAppender(conf));
             } else if(str == "ZMQAppender") {
                 pAsLogger->addAppender(new ZMQAppender("tcp://" + conf.inetAddr
-                                                       + ":" + std::to_string(conf.port)));
+                                                       + ":" + std::to_string(conf.port),
+                                                       conf.zmqSend, conf.spool));
             } else if(str == "HTTPAppender") {
-                pAsLogger->addAppender(new HTTPAppender(conf.inetAddr, conf.port));
+                pAsLogger->addAppender(new HTTPAppender(conf.inetAddr, conf.port, conf.httpBatch, conf.httpSend, conf.spool));
             }
         }
     }
@@ -124,6 +152,8 @@ AsLogger::sptr AsLoggerFactory::initialize(const std::string & name, const LogLe
     if(!pAsLogger) {
         pAsLogger = std::make_shared<AsLogger>(name, level, size);
         m_loggers[name] = pAsLogger;
+        //默认logger是名字最小的logger
+        m_defaultLogger.store(m_loggers.begin()->second.get(), std::memory_order_release);
     }
 
     return pAsLogger;
@@ -0,0 +1,190 @@
+#include <ctime>
+#include <cctype>
+#include <vector>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+
+#include "segmentlist.hpp"
+#include "logcompressor.hpp"
+#include "filewriter.hpp"
+
+namespace daq {
+
+static bool endsWith(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size()
+           && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+//RollFileAppender生成的时间戳部分：14位数字，后面可以有"-序号"
+static bool isStamp(const std::string& stamp) {
+    if (stamp.size() < 14) {
+        return false;
+    }
+    for (size_t i = 0; i < stamp.size(); ++i) {
+        if (!isdigit(stamp[i]) && !(i >= 14 && stamp[i] == '-')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SegmentList::scan(const std::string& dir, const std::string& prefix, const std::string& subfix) {
+    namespace fs = boost::filesystem;
+    boost::system::error_code ec;
+    std::vector<Segment> found;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!fs::is_regular_file(it->status())) {
+            continue;
+        }
+        std::string name = it->path().filename().string();
+        std::string base = name;
+        //压缩到一半的临时文件，原文件还在
+        if (endsWith(base, ".tmp")) {
+            base.resize(base.size() - 4);
+            if (endsWith(base, ".gz") || endsWith(base, ".zst")) {
+                base.resize(base.rfind('.'));
+                if (base.compare(0, prefix.size(), prefix) == 0 && endsWith(base, subfix)
+                        && isStamp(base.substr(prefix.size(), base.size() - prefix.size() - subfix.size()))) {
+                    unlink(it->path().c_str());
+                }
+            }
+            continue;
+        }
+        if (endsWith(base, ".gz") || endsWith(base, ".zst")) {
+            base.resize(base.rfind('.'));
+        }
+        if (base.size() < prefix.size() + subfix.size()
+                || base.compare(0, prefix.size(), prefix) != 0 || !endsWith(base, subfix)
+                || !isStamp(base.substr(prefix.size(), base.size() - prefix.size() - subfix.size()))) {
+            continue;
+        }
+        struct stat st;
+        if (stat(it->path().c_str(), &st) != 0) {
+            continue;
+        }
+        found.push_back(Segment{it->path().string(), uint64_t(st.st_size), int64_t(st.st_mtime), false});
+    }
+    //时间戳在文件名中，按文件名排序就是按时间排序
+    std::sort(found.begin(), found.end(), [](const Segment& a, const Segment& b) {
+        return a.path < b.path;
+    });
+
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    for (auto& segment : found) {
+        m_totalBytes += segment.size;
+        m_segments.push_back(std::move(segment));
+    }
+}
+
+void SegmentList::add(const std::string& path, uint64_t size, bool compressing) {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    m_segments.push_back(Segment{path, size, int64_t(time(nullptr)), compressing});
+    m_totalBytes += size;
+}
+
+void SegmentList::replace(const std::string& from, const std::string& to) {
+    struct stat st;
+    bool exists = stat(to.c_str(), &st) == 0;
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    for (auto& segment : m_segments) {
+        if (segment.path == from) {
+            if (exists) {
+                m_totalBytes = m_totalBytes - segment.size + st.st_size;
+                segment.size = st.st_size;
+            }
+            segment.path = to;
+            segment.compressing = false;
+            break;
+        }
+    }
+}
+
+std::vector<std::string> SegmentList::takeUncompressed() {
+    std::vector<std::string> paths;
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    for (auto& segment : m_segments) {
+        if (!segment.compressing && !endsWith(segment.path, ".gz") && !endsWith(segment.path, ".zst")) {
+            segment.compressing = true;
+            paths.push_back(segment.path);
+        }
+    }
+    return paths;
+}
+
+//按时间保留时检查的间隔，秒
+static const uint32_t AGE_CHECK_SEC = 60;
+
+SegmentList::~SegmentList() {
+    LogFlusher::instance()->remove(this);
+}
+
+void SegmentList::setPolicy(const RetentionPolicy& policy) {
+    {
+        std::lock_guard<std::mutex> lock_guard(m_mutex);
+        m_policy = policy;
+    }
+    //没有滚动时文件也会过期，定时检查；间隔不超过保留时间
+    uint32_t intervalSec = std::min(policy.maxAgeSec, AGE_CHECK_SEC);
+    std::weak_ptr<SegmentList> weak = shared_from_this();
+    LogFlusher::instance()->add(this, [weak]() {
+        if (sptr self = weak.lock()) {
+            self->enforce();
+        }
+    }, intervalSec * 1000);
+}
+
+uint64_t SegmentList::getTotalBytes() {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    return m_totalBytes;
+}
+
+size_t SegmentList::size() {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    return m_segments.size();
+}
+
+bool SegmentList::exceeded(int64_t now) const {
+    if (m_segments.empty()) {
+        return false;
+    }
+    return (m_policy.maxFiles != 0 && m_segments.size() > m_policy.maxFiles)
+           || (m_policy.maxBytes != 0 && m_totalBytes > m_policy.maxBytes)
+           || (m_policy.maxAgeSec != 0 && now - m_segments.front().closeTime > int64_t(m_policy.maxAgeSec));
+}
+
+void SegmentList::enforce() {
+    {
+        std::lock_guard<std::mutex> lock_guard(m_mutex);
+        if (m_cleaning || !exceeded(time(nullptr))) {
+            return;
+        }
+        m_cleaning = true;
+    }
+    sptr self = shared_from_this();
+    LogCompressor::instance()->post([self]() {
+        self->clean();
+    });
+}
+
+void SegmentList::clean() {
+    std::vector<std::string> victims;
+    {
+        std::lock_guard<std::mutex> lock_guard(m_mutex);
+        int64_t now = time(nullptr);
+        //正在压缩的文件等压缩完成后再删除，压缩完成时会再次检查
+        while (exceeded(now) && !m_segments.front().compressing) {
+            victims.push_back(std::move(m_segments.front().path));
+            m_totalBytes -= m_segments.front().size;
+            m_segments.pop_front();
+        }
+        m_cleaning = false;
+    }
+    for (const auto& path : victims) {
+        unlink(path.c_str());
+    }
+}
+
+}
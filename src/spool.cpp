@@ -0,0 +1,391 @@
+#include <cerrno>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <boost/filesystem.hpp>
+
+#include "spool.hpp"
+
+namespace daq {
+
+namespace {
+
+//每条记录的头部，后面是len字节的数据
+struct RecordHeader {
+    uint32_t len;
+    uint32_t crc;       //flags和数据的crc32
+    uint32_t flags;
+};
+
+//offset文件的内容
+struct ReadOffset {
+    uint64_t seq;
+    uint64_t offset;
+};
+
+const char SEGMENT_SUBFIX[] = ".spool";
+
+uint32_t recordCrc(const char* data, size_t len, uint32_t flags) {
+    uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(&flags), sizeof(flags));
+    return uint32_t(crc32(crc, reinterpret_cast<const Bytef*>(data), uInt(len)));
+}
+
+bool preadAll(int fd, char* data, size_t len, uint64_t offset) {
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = ::pread(fd, data + total, len - total, offset + total);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        total += n;
+    }
+    return true;
+}
+
+}
+
+std::unique_ptr<Spool> Spool::open(const SpoolPolicy& policy) {
+    std::unique_ptr<Spool> spool(new Spool(policy));
+    if (!spool->init()) {
+        return nullptr;
+    }
+    return spool;
+}
+
+Spool::Spool(const SpoolPolicy& policy) : m_policy(policy) {
+    if (m_policy.segmentBytes == 0) {
+        m_policy.segmentBytes = SpoolPolicy().segmentBytes;
+    }
+}
+
+Spool::~Spool() {
+    if (m_writeFd >= 0) {
+        ::close(m_writeFd);
+    }
+    if (m_readFd >= 0) {
+        ::close(m_readFd);
+    }
+    if (m_offsetFd >= 0) {
+        ::close(m_offsetFd);
+    }
+}
+
+bool Spool::init() {
+    namespace fs = boost::filesystem;
+    boost::system::error_code ec;
+    fs::create_directories(m_policy.dir, ec);
+    if (!fs::is_directory(m_policy.dir, ec)) {
+        std::cout << "Spool " << m_policy.dir << " is not a directory" << std::endl;
+        return false;
+    }
+    m_offsetFd = ::open((m_policy.dir + "/offset").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (m_offsetFd < 0) {
+        std::cout << "Spool " << m_policy.dir << " open offset error: " << strerror(errno) << std::endl;
+        return false;
+    }
+    ReadOffset saved = {0, 0};
+    if (!preadAll(m_offsetFd, reinterpret_cast<char*>(&saved), sizeof(saved), 0)) {
+        saved = ReadOffset{0, 0};
+    }
+
+    std::vector<Segment> found;
+    for (fs::directory_iterator it(m_policy.dir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        size_t digits = name.size() - (sizeof(SEGMENT_SUBFIX) - 1);
+        if (name.size() <= sizeof(SEGMENT_SUBFIX) - 1 || name.compare(digits, std::string::npos, SEGMENT_SUBFIX) != 0
+                || !std::all_of(name.begin(), name.begin() + digits, ::isdigit)) {
+            continue;
+        }
+        struct stat st;
+        if (stat(it->path().c_str(), &st) != 0) {
+            continue;
+        }
+        found.push_back(Segment{std::stoull(name.substr(0, digits)), uint64_t(st.st_size)});
+    }
+    std::sort(found.begin(), found.end(), [](const Segment& a, const Segment& b) {
+        return a.seq < b.seq;
+    });
+
+    m_lastSeq = saved.seq;
+    for (const Segment& segment : found) {
+        //上次已经读完，删除时进程退出了
+        if (segment.seq < saved.seq) {
+            unlink(segmentPath(segment.seq).c_str());
+            continue;
+        }
+        m_segments.push_back(segment);
+        m_totalBytes += segment.size;
+        m_lastSeq = std::max(m_lastSeq, segment.seq);
+    }
+    if (!m_segments.empty() && m_segments.front().seq == saved.seq) {
+        m_readOffset = std::min(saved.offset, m_segments.front().size);
+    }
+    if (!m_segments.empty()) {
+        std::cout << "Spool " << m_policy.dir << " has " << m_totalBytes - m_readOffset
+                  << " bytes from the last run" << std::endl;
+    }
+    return true;
+}
+
+std::string Spool::segmentPath(uint64_t seq) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llu", static_cast<unsigned long long>(seq));
+    return m_policy.dir + "/" + name + SEGMENT_SUBFIX;
+}
+
+bool Spool::roll() {
+    if (m_writeFd >= 0) {
+        ::close(m_writeFd);
+        m_writeFd = -1;
+    }
+    uint64_t seq = m_lastSeq + 1;
+    m_writeFd = ::open(segmentPath(seq).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (m_writeFd < 0) {
+        std::cout << "Spool " << m_policy.dir << " open segment error: " << strerror(errno) << std::endl;
+        return false;
+    }
+    m_lastSeq = seq;
+    m_segments.push_back(Segment{seq, 0});
+    return true;
+}
+
+bool Spool::push(const char* data, size_t len, uint32_t flags) {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    uint64_t size = sizeof(RecordHeader) + len;
+    if (m_writeFd < 0 || (m_segments.back().size > 0 && m_segments.back().size + size > m_policy.segmentBytes)) {
+        if (!roll()) {
+            return false;
+        }
+    }
+    //超过上限时删除最旧的段，保留最新的日志
+    while (m_policy.maxBytes > 0 && m_totalBytes + size > m_policy.maxBytes && m_segments.size() > 1) {
+        dropFront();
+    }
+
+    RecordHeader header = {uint32_t(len), recordCrc(data, len, flags), flags};
+    struct iovec iov[2];
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = const_cast<char*>(data);
+    iov[1].iov_len = len;
+    ssize_t n;
+    do {
+        n = ::writev(m_writeFd, iov, 2);
+    } while (n < 0 && errno == EINTR);
+    Segment& segment = m_segments.back();
+    if (n != ssize_t(size)) {
+        std::cout << "Spool " << m_policy.dir << " write error: "
+                  << (n < 0 ? strerror(errno) : "short write") << std::endl;
+        //去掉写了一半的记录
+        if (n > 0 && ftruncate(m_writeFd, segment.size) != 0) {
+            segment.size += n;
+            m_totalBytes += n;
+            roll();
+        }
+        return false;
+    }
+    segment.size += size;
+    m_totalBytes += size;
+    return true;
+}
+
+bool Spool::front(std::string& data, uint32_t& flags) {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    if (!loadHead()) {
+        return false;
+    }
+    data = m_head;
+    flags = m_headFlags;
+    return true;
+}
+
+size_t Spool::peek(std::vector<std::string>& records, size_t maxCount, size_t maxBytes,
+                   size_t skip, std::vector<uint32_t>* flags) {
+    records.clear();
+    if (flags) {
+        flags->clear();
+    }
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    if (maxCount == 0 || !loadHead() || skip > m_peekLens.size()) {
+        return 0;
+    }
+    //跳过的记录已经在读出的窗口中，长度已知
+    uint64_t offset = m_readOffset;
+    for (size_t i = 0; i < skip; ++i) {
+        offset += sizeof(RecordHeader) + m_peekLens[i];
+    }
+    size_t index = skip;
+    size_t bytes = 0;
+    if (skip == 0) {
+        records.push_back(m_head);
+        if (flags) {
+            flags->push_back(m_headFlags);
+        }
+        offset += sizeof(RecordHeader) + m_head.size();
+        bytes = m_head.size();
+        index = 1;
+    }
+    //之后的记录只在同一个段中顺序读取，遇到段尾或者损坏的记录时停止，留给下一次loadHead处理
+    const Segment& segment = m_segments.front();
+    while (records.size() < maxCount && segment.size - offset >= sizeof(RecordHeader)) {
+        RecordHeader header;
+        if (!preadAll(m_readFd, reinterpret_cast<char*>(&header), sizeof(header), offset)
+                || header.len > segment.size - offset - sizeof(header)
+                || (!records.empty() && bytes + header.len > maxBytes)) {
+            break;
+        }
+        std::string data(header.len, '\0');
+        if (!preadAll(m_readFd, &data[0], header.len, offset + sizeof(header))
+                || recordCrc(data.data(), data.size(), header.flags) != header.crc) {
+            break;
+        }
+        if (index == m_peekLens.size()) {
+            m_peekLens.push_back(header.len);
+        }
+        ++index;
+        bytes += header.len;
+        offset += sizeof(header) + header.len;
+        records.push_back(std::move(data));
+        if (flags) {
+            flags->push_back(header.flags);
+        }
+    }
+    return records.size();
+}
+
+bool Spool::loadHead() {
+    while (!m_headValid) {
+        if (m_segments.empty()) {
+            return false;
+        }
+        const Segment& segment = m_segments.front();
+        if (m_readOffset >= segment.size) {
+            //写段读完了，等待新的记录
+            if (m_writeFd >= 0 && m_segments.size() == 1) {
+                return false;
+            }
+            dropFront();
+            continue;
+        }
+        if (m_readFd < 0) {
+            m_readFd = ::open(segmentPath(segment.seq).c_str(), O_RDONLY | O_CLOEXEC);
+        }
+        RecordHeader header;
+        bool ok = m_readFd >= 0
+                  && segment.size - m_readOffset >= sizeof(header)
+                  && preadAll(m_readFd, reinterpret_cast<char*>(&header), sizeof(header), m_readOffset)
+                  && header.len <= segment.size - m_readOffset - sizeof(header);
+        if (ok) {
+            m_head.resize(header.len);
+            ok = preadAll(m_readFd, &m_head[0], header.len, m_readOffset + sizeof(header))
+                 && recordCrc(m_head.data(), m_head.size(), header.flags) == header.crc;
+        }
+        if (!ok) {
+            //进程崩溃时写了一半的记录，跳过这个段剩下的部分
+            std::cout << "Spool " << segmentPath(segment.seq) << " is corrupted at " << m_readOffset
+                      << ", skipped " << segment.size - m_readOffset << " bytes" << std::endl;
+            m_readOffset = segment.size;
+            m_peekLens.clear();
+            continue;
+        }
+        m_headFlags = header.flags;
+        m_headValid = true;
+    }
+    if (m_peekLens.empty()) {
+        m_peekLens.push_back(uint32_t(m_head.size()));
+    }
+    return true;
+}
+
+void Spool::pop(size_t count) {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    //读出之后段被dropFront删除了
+    if (m_peekLens.empty()) {
+        return;
+    }
+    count = std::min(count, m_peekLens.size());
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        m_readOffset += sizeof(RecordHeader) + m_peekLens[i];
+        bytes += m_peekLens[i];
+    }
+    m_peekLens.erase(m_peekLens.begin(), m_peekLens.begin() + count);
+    m_headValid = false;
+    if (m_policy.drainRate > 0) {
+        Clock::time_point now = Clock::now();
+        m_nextDrain = std::max(m_nextDrain, now)
+                      + std::chrono::microseconds(bytes * 1000000 / m_policy.drainRate);
+    }
+    //读完的段立即删除，释放磁盘空间
+    if (m_readOffset >= m_segments.front().size && !(m_writeFd >= 0 && m_segments.size() == 1)) {
+        dropFront();
+    } else {
+        saveOffset();
+    }
+}
+
+bool Spool::empty() {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    return m_totalBytes == m_readOffset;
+}
+
+uint64_t Spool::bytes() {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    return m_totalBytes - m_readOffset;
+}
+
+uint64_t Spool::lostSegments() {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    return m_lostSegments;
+}
+
+uint32_t Spool::delayMs() {
+    std::lock_guard<std::mutex> lock_guard(m_mutex);
+    Clock::time_point now = Clock::now();
+    if (now >= m_nextDrain) {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(m_nextDrain - now).count() + 1;
+}
+
+void Spool::dropFront() {
+    const Segment& segment = m_segments.front();
+    if (m_readOffset < segment.size) {
+        std::cout << "Spool " << m_policy.dir << " is full, dropped "
+                  << segment.size - m_readOffset << " bytes" << std::endl;
+        ++m_lostSegments;
+    }
+    if (m_readFd >= 0) {
+        ::close(m_readFd);
+        m_readFd = -1;
+    }
+    unlink(segmentPath(segment.seq).c_str());
+    m_totalBytes -= segment.size;
+    m_segments.pop_front();
+    m_readOffset = 0;
+    m_headValid = false;
+    m_peekLens.clear();
+    saveOffset();
+}
+
+void Spool::saveOffset() {
+    //没有段时保存最后的序号，之后的段序号更大，重启时从头读
+    ReadOffset offset = {m_segments.empty() ? m_lastSeq : m_segments.front().seq, m_readOffset};
+    if (::pwrite(m_offsetFd, &offset, sizeof(offset), 0) != ssize_t(sizeof(offset))) {
+        std::cout << "Spool " << m_policy.dir << " save offset error: " << strerror(errno) << std::endl;
+    }
+}
+
+}
@@ -0,0 +1,177 @@
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+#include <czmq.h>
+
+#include "zmqbatch.hpp"
+
+namespace daq {
+
+//缓冲块的大小，超过的日志单独分配
+static const size_t CHUNK_SIZE = 64 * 1024;
+//缓冲池中最多保留的空闲缓冲块
+static const size_t MAX_FREE_CHUNKS = 16;
+
+//Chunk 头部后面紧跟size字节的数据
+/*******************************************************************************/
+struct ZmqBatch::Chunk {
+    std::atomic<int> refs;
+    size_t size;
+    std::shared_ptr<ChunkPool> pool;    //借出时持有，放回缓冲池时释放，避免循环引用
+
+    char* data() {
+        return reinterpret_cast<char*>(this + 1);
+    }
+    void retain() {
+        refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    /// @brief release 最后一个引用释放时放回缓冲池，可能在ZMQ的I/O线程中调用
+    void release();
+
+    static Chunk* create(size_t size) {
+        void* mem = malloc(sizeof(Chunk) + size);
+        if (mem == nullptr) {
+            throw std::bad_alloc();
+        }
+        Chunk* chunk = new (mem) Chunk();
+        chunk->size = size;
+        return chunk;
+    }
+    static void destroy(Chunk* chunk) {
+        chunk->~Chunk();
+        free(chunk);
+    }
+};
+
+//ChunkPool
+/*******************************************************************************/
+class ZmqBatch::ChunkPool {
+    public:
+        ~ChunkPool() {
+            for (Chunk* chunk : m_free) {
+                Chunk::destroy(chunk);
+            }
+        }
+
+        /// @brief get 借出一个至少size字节的缓冲块，引用计数为1
+        Chunk* get(size_t size, const std::shared_ptr<ChunkPool>& self) {
+            Chunk* chunk = nullptr;
+            if (size <= CHUNK_SIZE) {
+                std::lock_guard<std::mutex> lock_guard(m_mutex);
+                if (!m_free.empty()) {
+                    chunk = m_free.back();
+                    m_free.pop_back();
+                }
+            }
+            if (chunk == nullptr) {
+                chunk = Chunk::create(std::max(size, CHUNK_SIZE));
+            }
+            chunk->refs.store(1, std::memory_order_relaxed);
+            chunk->pool = self;
+            return chunk;
+        }
+
+        void put(Chunk* chunk) {
+            if (chunk->size == CHUNK_SIZE) {
+                std::lock_guard<std::mutex> lock_guard(m_mutex);
+                if (m_free.size() < MAX_FREE_CHUNKS) {
+                    m_free.push_back(chunk);
+                    return;
+                }
+            }
+            Chunk::destroy(chunk);
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::vector<Chunk*> m_free;
+};
+
+void ZmqBatch::Chunk::release() {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        //Appender已经析构时，这是缓冲池的最后一个引用
+        std::shared_ptr<ChunkPool> owner = std::move(pool);
+        owner->put(this);
+    }
+}
+
+//zmq_msg_init_data的释放函数，hint是帧所在的缓冲块
+static void releaseFrame(void*, void* hint) {
+    static_cast<ZmqBatch::Chunk*>(hint)->release();
+}
+
+//ZmqBatch
+/*******************************************************************************/
+ZmqBatch::ZmqBatch() : m_pool(std::make_shared<ChunkPool>()) {}
+
+ZmqBatch::~ZmqBatch() {
+    clear();
+    if (m_chunk) {
+        m_chunk->release();
+    }
+}
+
+void ZmqBatch::add(const char* data, size_t len) {
+    Chunk* chunk = nullptr;
+    char* dest = nullptr;
+    if (len > CHUNK_SIZE) {
+        chunk = m_pool->get(len, m_pool);
+        dest = chunk->data();
+    } else {
+        if (m_chunk == nullptr || m_used + len > CHUNK_SIZE) {
+            //旧的缓冲块在它的帧都发送完后放回缓冲池
+            if (m_chunk) {
+                m_chunk->release();
+            }
+            m_chunk = m_pool->get(CHUNK_SIZE, m_pool);
+            m_used = 0;
+        }
+        chunk = m_chunk;
+        chunk->retain();
+        dest = chunk->data() + m_used;
+        m_used += len;
+    }
+    memcpy(dest, data, len);
+    m_frames.push_back(Frame{chunk, dest, len});
+    m_bytes += len;
+}
+
+bool ZmqBatch::send(void* socket) {
+    //每帧另外给ZMQ一个缓冲块的引用，批次持有的引用保留到整个消息发送完，
+    //中途失败时已经交给ZMQ的帧的数据仍然有效，整个批次可以重新发送
+    for (m_sent = 0; m_sent < m_frames.size(); ++m_sent) {
+        Frame& frame = m_frames[m_sent];
+        zmq_msg_t msg;
+        frame.chunk->retain();
+        zmq_msg_init_data(&msg, const_cast<char*>(frame.data), frame.len, releaseFrame, frame.chunk);
+        int flags = m_sent + 1 < m_frames.size() ? ZMQ_SNDMORE : 0;
+        if (zmq_msg_send(&msg, socket, flags) < 0) {
+            //发送失败时消息仍然属于调用者，关闭时释放交给ZMQ的引用
+            zmq_msg_close(&msg);
+            return false;
+        }
+    }
+    clear();
+    return true;
+}
+
+void ZmqBatch::forEach(const std::function<void(const char*, size_t)>& func) const {
+    for (const Frame& frame : m_frames) {
+        func(frame.data, frame.len);
+    }
+}
+
+void ZmqBatch::clear() {
+    for (Frame& frame : m_frames) {
+        frame.chunk->release();
+    }
+    m_frames.clear();
+    m_bytes = 0;
+    m_sent = 0;
+}
+
+}